@@ -0,0 +1,186 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "batch.h"
+#include "eval.h"
+#include "nnue.h"
+
+typedef struct batch_worker {
+  const position_batch_t *batch;
+  batch_results_t *results;
+  int start;
+  int end;
+  pthread_t thread;
+  game_t game;
+} batch_worker_t;
+
+void init_position_batch(position_batch_t *batch, int count) {
+  size_t bitboards_size = sizeof(bitboard_t) * 12 * count;
+  uint8_t *buffer = (uint8_t*)aligned_alloc(64, (bitboards_size + 3 * count + 63) & ~(size_t) 63);
+
+  batch->count = count;
+  batch->buffer = buffer;
+  for (int color = WHITE; color <= BLACK; color++) {
+    for (int piece_type = PAWN; piece_type <= KING; piece_type++) {
+      batch->pieces[color][piece_type] = (bitboard_t*) buffer + (color * 6 + piece_type) * count;
+    }
+  }
+  batch->color_to_move = buffer + bitboards_size;
+  batch->castling_rights = batch->color_to_move + count;
+  batch->en_passant_square = (int8_t*) (batch->castling_rights + count);
+}
+
+void free_position_batch(position_batch_t *batch) {
+  free(batch->buffer);
+  memset(batch, 0, sizeof(position_batch_t));
+}
+
+void set_batch_position(position_batch_t *batch, int index, game_t *game) {
+  for (int color = WHITE; color <= BLACK; color++) {
+    for (int piece_type = PAWN; piece_type <= KING; piece_type++) {
+      batch->pieces[color][piece_type][index] = game->position.pieces[color][piece_type];
+    }
+  }
+  batch->color_to_move[index] = (uint8_t) game->color_to_move;
+  batch->castling_rights[index] = (uint8_t) game->castling_rights;
+  batch->en_passant_square[index] = (int8_t) game->en_passant_square;
+}
+
+void init_batch_results(batch_results_t *results, int count, bool with_moves) {
+  size_t counts_size = sizeof(int) * count;
+  size_t evals_size = sizeof(int) * count;
+  size_t moves_size = with_moves ? sizeof(move_t) * MAX_MOVES * count : 0;
+  uint8_t *buffer = (uint8_t*)aligned_alloc(64, (counts_size + evals_size + moves_size + count + 63) & ~(size_t) 63);
+
+  results->count = count;
+  results->buffer = buffer;
+  results->move_counts = (int*) buffer;
+  results->evals = (int*) (buffer + counts_size);
+  results->moves = with_moves ? (move_t*) (buffer + counts_size + evals_size) : NULL;
+  results->in_check = buffer + counts_size + evals_size + moves_size;
+}
+
+void free_batch_results(batch_results_t *results) {
+  free(results->buffer);
+  memset(results, 0, sizeof(batch_results_t));
+}
+
+/*
+ * Reads the piece columns directly instead of unpacking each position into
+ * a board_t, so the loop touches only the columns it needs.
+ */
+static void compute_in_check(const position_batch_t *batch, uint8_t *in_check, int start, int end) {
+  bitboard_t *const (*pieces)[6] = batch->pieces;
+
+  for (int i = start; i < end; i++) {
+    color_t us = (color_t) batch->color_to_move[i];
+    color_t them = (us == WHITE) ? BLACK : WHITE;
+    bitboard_t occupancy = 0;
+    for (int piece_type = PAWN; piece_type <= KING; piece_type++) {
+      occupancy |= pieces[WHITE][piece_type][i] | pieces[BLACK][piece_type][i];
+    }
+    if (pieces[us][KING][i] == 0) {
+      in_check[i] = 0;
+      continue;
+    }
+    int king_square = lsb(pieces[us][KING][i]);
+    in_check[i] = ((pawn_attacks[us][king_square] & pieces[them][PAWN][i]) |
+                   (knight_attacks[king_square] & pieces[them][KNIGHT][i]) |
+                   (bishop_attacks(king_square, occupancy) & (pieces[them][BISHOP][i] | pieces[them][QUEEN][i])) |
+                   (rook_attacks(king_square, occupancy) & (pieces[them][ROOK][i] | pieces[them][QUEEN][i])) |
+                   (king_attacks[king_square] & pieces[them][KING][i])) != 0;
+  }
+}
+
+/* Nothing in the batch reads the hash keys, so they are left unset. */
+static void load_batch_position(game_t *game, const position_batch_t *batch, int index) {
+  board_t *board = &game->position;
+
+  board->occupancy[WHITE] = 0;
+  board->occupancy[BLACK] = 0;
+  board->material_key = 0;
+  for (int color = WHITE; color <= BLACK; color++) {
+    for (int piece_type = PAWN; piece_type <= KING; piece_type++) {
+      bitboard_t bb = batch->pieces[color][piece_type][index];
+      board->pieces[color][piece_type] = bb;
+      board->occupancy[color] |= bb;
+      board->material_key += pop_count(bb) * MATERIAL_UNIT(color, piece_type);
+    }
+  }
+  game->color_to_move = (color_t) batch->color_to_move[index];
+  game->castling_rights = batch->castling_rights[index];
+  game->en_passant_square = batch->en_passant_square[index];
+  game->halfmove_clock = 0;
+  game->plies_since_null = 0;
+  game->fullmove_number = 1;
+  game->undo_stack.count = 0;
+  game->key_history_count = 0;
+  game->key = 0;
+  board->pawn_key = 0;
+  if (game->nnue) {
+    nnue_reset(game->nnue);
+  }
+}
+
+static void *batch_worker_thread(void *arg) {
+  batch_worker_t *worker = (batch_worker_t*) arg;
+  const position_batch_t *batch = worker->batch;
+  batch_results_t *results = worker->results;
+  move_list_t move_list;
+  game_t *game = &worker->game;
+
+  if (results->in_check) {
+    compute_in_check(batch, results->in_check, worker->start, worker->end);
+  }
+  if (!results->move_counts && !results->moves && !results->evals) {
+    return NULL;
+  }
+  for (int i = worker->start; i < worker->end; i++) {
+    load_batch_position(game, batch, i);
+    if (results->move_counts || results->moves) {
+      init_move_list(&move_list);
+      calculate_legal_moves(game, &move_list);
+      if (results->move_counts) {
+        results->move_counts[i] = move_list.count;
+      }
+      if (results->moves) {
+        memcpy(results->moves + (size_t) i * MAX_MOVES, move_list.entries, sizeof(move_t) * move_list.count);
+      }
+    }
+    if (results->evals) {
+      results->evals[i] = evaluate(game);
+    }
+  }
+  return NULL;
+}
+
+void process_batch(const position_batch_t *batch, batch_results_t *results, int thread_count) {
+  if (thread_count < 1) {
+    thread_count = 1;
+  }
+  if (thread_count > batch->count) {
+    thread_count = batch->count > 0 ? batch->count : 1;
+  }
+  batch_worker_t *workers = (batch_worker_t*)calloc(thread_count, sizeof(batch_worker_t));
+  for (int i = 0; i < thread_count; i++) {
+    workers[i].batch = batch;
+    workers[i].results = results;
+    workers[i].start = (int) ((long long) batch->count * i / thread_count);
+    workers[i].end = (int) ((long long) batch->count * (i + 1) / thread_count);
+    init_game(&workers[i].game);
+    if (results->evals && nnue_is_loaded()) {
+      nnue_attach(&workers[i].game);
+    }
+  }
+  for (int i = 1; i < thread_count; i++) {
+    pthread_create(&workers[i].thread, NULL, batch_worker_thread, &workers[i]);
+  }
+  batch_worker_thread(&workers[0]);
+  for (int i = 1; i < thread_count; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  for (int i = 0; i < thread_count; i++) {
+    free_game(&workers[i].game);
+  }
+  free(workers);
+}
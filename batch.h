@@ -0,0 +1,42 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "game.h"
+
+/*
+ * Positions and results are stored column-wise. Any result column may be
+ * NULL to skip computing it. Legal moves use a fixed stride: the moves of
+ * position i start at moves[i * MAX_MOVES].
+ *
+ * Only in_check is computed straight from the piece columns. Move lists
+ * and evals still unpack each position into a game_t and run the scalar
+ * code, so for those the layout is just a compact transport format.
+ * Those paths require each row to be a legal position with one king per
+ * side; in_check alone tolerates a missing king and reports 0.
+ */
+typedef struct position_batch {
+  int count;
+  bitboard_t *pieces[2][6];
+  uint8_t *color_to_move;
+  uint8_t *castling_rights;
+  int8_t *en_passant_square;
+  void *buffer;
+} position_batch_t;
+
+typedef struct batch_results {
+  int count;
+  int *move_counts;
+  move_t *moves;
+  uint8_t *in_check;
+  int *evals;
+  void *buffer;
+} batch_results_t;
+
+void init_position_batch(position_batch_t *batch, int count);
+void free_position_batch(position_batch_t *batch);
+void set_batch_position(position_batch_t *batch, int index, game_t *game);
+void init_batch_results(batch_results_t *results, int count, bool with_moves);
+void free_batch_results(batch_results_t *results);
+void process_batch(const position_batch_t *batch, batch_results_t *results, int thread_count);
+
+#endif
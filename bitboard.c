@@ -0,0 +1,160 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "bitboard.h"
+
+#define BISHOP_TABLE_SIZE 5248
+#define ROOK_TABLE_SIZE 102400
+
+static const int bishop_directions[4][2] = { { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+static const int rook_directions[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+static const int knight_offsets[8][2] = { { 2, 1 }, { 2, -1 }, { -2, 1 }, { -2, -1 }, { 1, 2 }, { 1, -2 }, { -1, 2 }, { -1, -2 } };
+
+bitboard_t knight_attacks[64];
+bitboard_t king_attacks[64];
+bitboard_t pawn_attacks[2][64];
+bitboard_t between_bb[64][64];
+bitboard_t line_bb[64][64];
+magic_t bishop_magics[64];
+magic_t rook_magics[64];
+
+static bitboard_t bishop_table[BISHOP_TABLE_SIZE];
+static bitboard_t rook_table[ROOK_TABLE_SIZE];
+
+static bool is_valid_square(int row, int col) {
+  return row >= 0 && row <= 7 && col >= 0 && col <= 7;
+}
+
+static bitboard_t sliding_attacks(int square, bitboard_t occupancy, const int directions[4][2]) {
+  bitboard_t attacks = 0;
+  for (int di = 0; di < 4; di++) {
+    int row = SQUARE_ROW(square) + directions[di][0];
+    int col = SQUARE_COL(square) + directions[di][1];
+    while (is_valid_square(row, col)) {
+      attacks |= SQUARE_BB(SQUARE(row, col));
+      if (occupancy & SQUARE_BB(SQUARE(row, col))) {
+        break;
+      }
+      row += directions[di][0];
+      col += directions[di][1];
+    }
+  }
+  return attacks;
+}
+
+#ifndef USE_PEXT
+static uint64_t random_u64(uint64_t *state) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 2685821657736338717ULL;
+}
+#endif
+
+static void init_magics(magic_t magics[64], bitboard_t *table, const int directions[4][2]) {
+  static bitboard_t occupancies[4096];
+  static bitboard_t references[4096];
+  bitboard_t *attacks = table;
+#ifndef USE_PEXT
+  static int epochs[4096];
+  static const uint64_t seeds[8] = { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
+  int epoch = 0;
+
+  memset(epochs, 0, sizeof(epochs));
+#endif
+  for (int square = 0; square < 64; square++) {
+    magic_t *magic = &magics[square];
+    bitboard_t edges = ((ROW_BB(0) | ROW_BB(7)) & ~ROW_BB(SQUARE_ROW(square))) |
+                       ((COL_0_BB | COL_7_BB) & ~(COL_0_BB << SQUARE_COL(square)));
+    magic->mask = sliding_attacks(square, 0, directions) & ~edges;
+    magic->shift = 64 - pop_count(magic->mask);
+    magic->attacks = attacks;
+
+    int size = 0;
+    bitboard_t subset = 0;
+    do {
+      occupancies[size] = subset;
+      references[size] = sliding_attacks(square, subset, directions);
+      size++;
+      subset = (subset - magic->mask) & magic->mask;
+    } while (subset);
+
+#ifdef USE_PEXT
+    for (int i = 0; i < size; i++) {
+      attacks[magic_index(magic, occupancies[i])] = references[i];
+    }
+#else
+    uint64_t seed = seeds[SQUARE_ROW(square)];
+    for (int i = 0; i < size;) {
+      do {
+        magic->magic = random_u64(&seed) & random_u64(&seed) & random_u64(&seed);
+      } while (pop_count((magic->mask * magic->magic) >> 56) < 6);
+      epoch++;
+      for (i = 0; i < size; i++) {
+        unsigned index = magic_index(magic, occupancies[i]);
+        if (epochs[index] < epoch) {
+          epochs[index] = epoch;
+          attacks[index] = references[i];
+        } else if (attacks[index] != references[i]) {
+          break;
+        }
+      }
+    }
+#endif
+    attacks += size;
+  }
+}
+
+void init_bitboards(void) {
+  static bool initialized = false;
+  if (initialized) {
+    return;
+  }
+  for (int square = 0; square < 64; square++) {
+    int row = SQUARE_ROW(square);
+    int col = SQUARE_COL(square);
+    knight_attacks[square] = 0;
+    king_attacks[square] = 0;
+    pawn_attacks[0][square] = 0;
+    pawn_attacks[1][square] = 0;
+    for (int dc = -1; dc <= 1; dc += 2) {
+      if (is_valid_square(row + 1, col + dc)) {
+        pawn_attacks[0][square] |= SQUARE_BB(SQUARE(row + 1, col + dc));
+      }
+      if (is_valid_square(row - 1, col + dc)) {
+        pawn_attacks[1][square] |= SQUARE_BB(SQUARE(row - 1, col + dc));
+      }
+    }
+    for (int oi = 0; oi < 8; oi++) {
+      if (is_valid_square(row + knight_offsets[oi][0], col + knight_offsets[oi][1])) {
+        knight_attacks[square] |= SQUARE_BB(SQUARE(row + knight_offsets[oi][0], col + knight_offsets[oi][1]));
+      }
+    }
+    for (int dr = -1; dr <= 1; dr++) {
+      for (int dc = -1; dc <= 1; dc++) {
+        if ((dr != 0 || dc != 0) && is_valid_square(row + dr, col + dc)) {
+          king_attacks[square] |= SQUARE_BB(SQUARE(row + dr, col + dc));
+        }
+      }
+    }
+  }
+  init_magics(bishop_magics, bishop_table, bishop_directions);
+  init_magics(rook_magics, rook_table, rook_directions);
+  for (int from = 0; from < 64; from++) {
+    for (int to = 0; to < 64; to++) {
+      between_bb[from][to] = 0;
+      line_bb[from][to] = 0;
+      if (from == to) {
+        continue;
+      }
+      if (bishop_attacks(from, 0) & SQUARE_BB(to)) {
+        between_bb[from][to] = bishop_attacks(from, SQUARE_BB(to)) & bishop_attacks(to, SQUARE_BB(from));
+        line_bb[from][to] = (bishop_attacks(from, 0) & bishop_attacks(to, 0)) | SQUARE_BB(from) | SQUARE_BB(to);
+      } else if (rook_attacks(from, 0) & SQUARE_BB(to)) {
+        between_bb[from][to] = rook_attacks(from, SQUARE_BB(to)) & rook_attacks(to, SQUARE_BB(from));
+        line_bb[from][to] = (rook_attacks(from, 0) & rook_attacks(to, 0)) | SQUARE_BB(from) | SQUARE_BB(to);
+      }
+    }
+  }
+  initialized = true;
+}
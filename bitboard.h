@@ -0,0 +1,75 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <stdint.h>
+
+#ifdef USE_PEXT
+#include <immintrin.h>
+#endif
+
+#define SQUARE(row, col) ((row) * 8 + (col))
+#define SQUARE_ROW(square) ((square) >> 3)
+#define SQUARE_COL(square) ((square) & 7)
+#define SQUARE_BB(square) (1ULL << (square))
+
+#define COL_0_BB 0x0101010101010101ULL
+#define COL_7_BB (COL_0_BB << 7)
+#define ROW_0_BB 0xFFULL
+#define ROW_BB(row) (ROW_0_BB << (8 * (row)))
+
+typedef uint64_t bitboard_t;
+
+typedef struct magic {
+  bitboard_t mask;
+  bitboard_t magic;
+  bitboard_t *attacks;
+  unsigned shift;
+} magic_t;
+
+extern bitboard_t knight_attacks[64];
+extern bitboard_t king_attacks[64];
+extern bitboard_t pawn_attacks[2][64];
+extern bitboard_t between_bb[64][64];
+extern bitboard_t line_bb[64][64];
+extern magic_t bishop_magics[64];
+extern magic_t rook_magics[64];
+
+void init_bitboards(void);
+
+static inline int lsb(bitboard_t bb) {
+  return __builtin_ctzll(bb);
+}
+
+static inline int pop_lsb(bitboard_t *bb) {
+  int square = __builtin_ctzll(*bb);
+  *bb &= *bb - 1;
+  return square;
+}
+
+static inline int pop_count(bitboard_t bb) {
+  return __builtin_popcountll(bb);
+}
+
+static inline unsigned magic_index(const magic_t *magic, bitboard_t occupancy) {
+#ifdef USE_PEXT
+  return (unsigned)_pext_u64(occupancy, magic->mask);
+#else
+  return (unsigned)(((occupancy & magic->mask) * magic->magic) >> magic->shift);
+#endif
+}
+
+static inline bitboard_t bishop_attacks(int square, bitboard_t occupancy) {
+  const magic_t *magic = &bishop_magics[square];
+  return magic->attacks[magic_index(magic, occupancy)];
+}
+
+static inline bitboard_t rook_attacks(int square, bitboard_t occupancy) {
+  const magic_t *magic = &rook_magics[square];
+  return magic->attacks[magic_index(magic, occupancy)];
+}
+
+static inline bitboard_t queen_attacks(int square, bitboard_t occupancy) {
+  return bishop_attacks(square, occupancy) | rook_attacks(square, occupancy);
+}
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <stdbool.h>
+
+#include "game.h"
+
+#define POLYGLOT_KEY_COUNT 781
+
+bool book_open(const char *path);
+void book_close(void);
+bool book_is_open(void);
+uint64_t book_key(game_t *game);
+move_t book_probe(game_t *game, bool best);
+
+#endif
@@ -0,0 +1,142 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "epd.h"
+
+#define CHUNK_SIZE (4 * 1024 * 1024)
+
+typedef struct epd_loader epd_loader_t;
+
+typedef struct epd_worker {
+  epd_loader_t *loader;
+  int thread_index;
+  pthread_t thread;
+  game_t game;
+  epd_stats_t stats;
+} epd_worker_t;
+
+struct epd_loader {
+  const char *data;
+  size_t size;
+  size_t chunk_count;
+  atomic_size_t next_chunk;
+  epd_callback_t callback;
+  void *arg;
+};
+
+static const char *line_start_at_or_after(const char *data, size_t size, size_t offset) {
+  if (offset == 0) {
+    return data;
+  }
+  if (offset >= size) {
+    return data + size;
+  }
+  const char *newline = memchr(data + offset - 1, '\n', size - offset + 1);
+  return newline ? newline + 1 : data + size;
+}
+
+static void parse_chunk(epd_worker_t *worker, game_t *game, const char *start, const char *end) {
+  epd_loader_t *loader = worker->loader;
+  char line[MAX_EPD_LINE_LENGTH];
+
+  while (start < end) {
+    const char *newline = memchr(start, '\n', end - start);
+    const char *line_end = newline ? newline : end;
+    size_t length = line_end - start;
+    if (length > 0 && start[length - 1] == '\r') {
+      length--;
+    }
+    if (length >= sizeof(line)) {
+      worker->stats.invalid++;
+    } else if (length > 0 && start[0] != '#') {
+      memcpy(line, start, length);
+      line[length] = '\0';
+      if (load_fen(game, line)) {
+        worker->stats.positions++;
+        loader->callback(game, line, worker->thread_index, loader->arg);
+      } else {
+        worker->stats.invalid++;
+      }
+    }
+    start = line_end + 1;
+  }
+}
+
+static void *epd_worker_thread(void *arg) {
+  epd_worker_t *worker = (epd_worker_t*) arg;
+  epd_loader_t *loader = worker->loader;
+  size_t chunk;
+
+  while ((chunk = atomic_fetch_add_explicit(&loader->next_chunk, 1, memory_order_relaxed)) < loader->chunk_count) {
+    const char *start = line_start_at_or_after(loader->data, loader->size, chunk * CHUNK_SIZE);
+    const char *end = line_start_at_or_after(loader->data, loader->size, (chunk + 1) * CHUNK_SIZE);
+    parse_chunk(worker, &worker->game, start, end);
+  }
+  return NULL;
+}
+
+bool load_epd_file(const char *path, int thread_count, epd_callback_t callback, void *arg, epd_stats_t *stats) {
+  epd_loader_t loader;
+  struct stat file_stat;
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0) {
+    return false;
+  }
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return false;
+  }
+  stats->positions = 0;
+  stats->invalid = 0;
+  if (file_stat.st_size == 0) {
+    close(fd);
+    return true;
+  }
+
+  loader.size = (size_t) file_stat.st_size;
+  loader.data = (const char*)mmap(NULL, loader.size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (loader.data == MAP_FAILED) {
+    return false;
+  }
+  madvise((void*) loader.data, loader.size, MADV_SEQUENTIAL | MADV_WILLNEED);
+  loader.chunk_count = (loader.size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  atomic_init(&loader.next_chunk, 0);
+  loader.callback = callback;
+  loader.arg = arg;
+
+  if (thread_count < 1) {
+    thread_count = 1;
+  }
+  if ((size_t) thread_count > loader.chunk_count) {
+    thread_count = (int) loader.chunk_count;
+  }
+  epd_worker_t *workers = (epd_worker_t*)calloc(thread_count, sizeof(epd_worker_t));
+  for (int i = 0; i < thread_count; i++) {
+    workers[i].loader = &loader;
+    workers[i].thread_index = i;
+    init_game(&workers[i].game);
+  }
+  for (int i = 1; i < thread_count; i++) {
+    pthread_create(&workers[i].thread, NULL, epd_worker_thread, &workers[i]);
+  }
+  epd_worker_thread(&workers[0]);
+  for (int i = 0; i < thread_count; i++) {
+    if (i > 0) {
+      pthread_join(workers[i].thread, NULL);
+    }
+    stats->positions += workers[i].stats.positions;
+    stats->invalid += workers[i].stats.invalid;
+    free_game(&workers[i].game);
+  }
+
+  free(workers);
+  munmap((void*) loader.data, loader.size);
+  return true;
+}
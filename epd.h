@@ -0,0 +1,19 @@
+#ifndef EPD_H
+#define EPD_H
+
+#include <stddef.h>
+
+#include "game.h"
+
+#define MAX_EPD_LINE_LENGTH 1024
+
+typedef void (*epd_callback_t)(game_t *game, const char *line, int thread_index, void *arg);
+
+typedef struct epd_stats {
+  unsigned long long positions;
+  unsigned long long invalid;
+} epd_stats_t;
+
+bool load_epd_file(const char *path, int thread_count, epd_callback_t callback, void *arg, epd_stats_t *stats);
+
+#endif
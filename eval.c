@@ -0,0 +1,236 @@
+#include "eval.h"
+#include "nnue.h"
+#include "stats.h"
+
+#define TOTAL_PHASE 24
+
+const int piece_values[6] = { 100, 320, 330, 500, 900, 0 };
+
+static const int phase_weights[6] = { 0, 1, 1, 2, 4, 0 };
+
+static const int piece_square_tables[6][64] = {
+  {
+      0,   0,   0,   0,   0,   0,   0,   0,
+     50,  50,  50,  50,  50,  50,  50,  50,
+     10,  10,  20,  30,  30,  20,  10,  10,
+      5,   5,  10,  25,  25,  10,   5,   5,
+      0,   0,   0,  20,  20,   0,   0,   0,
+      5,  -5, -10,   0,   0, -10,  -5,   5,
+      5,  10,  10, -20, -20,  10,  10,   5,
+      0,   0,   0,   0,   0,   0,   0,   0
+  },
+  {
+    -50, -40, -30, -30, -30, -30, -40, -50,
+    -40, -20,   0,   0,   0,   0, -20, -40,
+    -30,   0,  10,  15,  15,  10,   0, -30,
+    -30,   5,  15,  20,  20,  15,   5, -30,
+    -30,   0,  15,  20,  20,  15,   0, -30,
+    -30,   5,  10,  15,  15,  10,   5, -30,
+    -40, -20,   0,   5,   5,   0, -20, -40,
+    -50, -40, -30, -30, -30, -30, -40, -50
+  },
+  {
+    -20, -10, -10, -10, -10, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,  10,  10,   5,   0, -10,
+    -10,   5,   5,  10,  10,   5,   5, -10,
+    -10,   0,  10,  10,  10,  10,   0, -10,
+    -10,  10,  10,  10,  10,  10,  10, -10,
+    -10,   5,   0,   0,   0,   0,   5, -10,
+    -20, -10, -10, -10, -10, -10, -10, -20
+  },
+  {
+      0,   0,   0,   0,   0,   0,   0,   0,
+      5,  10,  10,  10,  10,  10,  10,   5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+      0,   0,   0,   5,   5,   0,   0,   0
+  },
+  {
+    -20, -10, -10,  -5,  -5, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,   5,   5,   5,   0, -10,
+     -5,   0,   5,   5,   5,   5,   0,  -5,
+      0,   0,   5,   5,   5,   5,   0,  -5,
+    -10,   5,   5,   5,   5,   5,   0, -10,
+    -10,   0,   5,   0,   0,   0,   0, -10,
+    -20, -10, -10,  -5,  -5, -10, -10, -20
+  },
+  {
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -20, -30, -30, -40, -40, -30, -30, -20,
+    -10, -20, -20, -20, -20, -20, -20, -10,
+     20,  20,   0,   0,   0,   0,  20,  20,
+     20,  30,  10,   0,   0,  10,  30,  20
+  }
+};
+
+static const int king_endgame_table[64] = {
+  -50, -40, -30, -20, -20, -30, -40, -50,
+  -30, -20, -10,   0,   0, -10, -20, -30,
+  -30, -10,  20,  30,  30,  20, -10, -30,
+  -30, -10,  30,  40,  40,  30, -10, -30,
+  -30, -10,  30,  40,  40,  30, -10, -30,
+  -30, -10,  20,  30,  30,  20, -10, -30,
+  -30, -30,   0,   0,   0,   0, -30, -30,
+  -50, -30, -30, -30, -30, -30, -30, -50
+};
+
+static int table_index(color_t color, int square) {
+  int row = (color == WHITE) ? 7 - SQUARE_ROW(square) : SQUARE_ROW(square);
+  return row * 8 + (7 - SQUARE_COL(square));
+}
+
+static const int passed_middlegame[8] = { 0, 5, 10, 15, 25, 40, 60, 0 };
+static const int passed_endgame[8] = { 0, 10, 20, 35, 60, 90, 130, 0 };
+
+#define DOUBLED_MIDDLEGAME 10
+#define DOUBLED_ENDGAME 20
+#define ISOLATED_MIDDLEGAME 10
+#define ISOLATED_ENDGAME 15
+#define SHELTER_NEAR 20
+#define SHELTER_FAR 10
+#define NO_KING_SQUARE 64
+
+static bitboard_t adjacent_cols(bitboard_t col) {
+  return ((col << 1) & ~COL_0_BB) | ((col >> 1) & ~COL_7_BB);
+}
+
+static bitboard_t forward_rows(color_t color, int square) {
+  int row = SQUARE_ROW(square);
+  if (color == WHITE) {
+    return (row == 7) ? 0 : ~0ULL << (8 * (row + 1));
+  }
+  return (1ULL << (8 * row)) - 1;
+}
+
+static void evaluate_pawns(board_t *board, pawn_entry_t *entry) {
+  int middlegame = 0;
+  int endgame = 0;
+
+  for (int color = WHITE; color <= BLACK; color++) {
+    int sign = (color == WHITE) ? 1 : -1;
+    bitboard_t pawns = board->pieces[color][PAWN];
+    bitboard_t enemy_pawns = board->pieces[!color][PAWN];
+    bitboard_t bb = pawns;
+    while (bb) {
+      int square = pop_lsb(&bb);
+      bitboard_t col = COL_0_BB << SQUARE_COL(square);
+      bitboard_t forward = forward_rows((color_t) color, square);
+      if (pawns & col & forward) {
+        middlegame -= sign * DOUBLED_MIDDLEGAME;
+        endgame -= sign * DOUBLED_ENDGAME;
+      }
+      if (!(pawns & adjacent_cols(col))) {
+        middlegame -= sign * ISOLATED_MIDDLEGAME;
+        endgame -= sign * ISOLATED_ENDGAME;
+      }
+      if (!(enemy_pawns & (col | adjacent_cols(col)) & forward)) {
+        int row = (color == WHITE) ? SQUARE_ROW(square) : 7 - SQUARE_ROW(square);
+        middlegame += sign * passed_middlegame[row];
+        endgame += sign * passed_endgame[row];
+      }
+    }
+  }
+  entry->key = board->pawn_key;
+  entry->middlegame = (int16_t) middlegame;
+  entry->endgame = (int16_t) endgame;
+  entry->king_squares[WHITE] = entry->king_squares[BLACK] = NO_KING_SQUARE;
+  entry->shelter[WHITE] = entry->shelter[BLACK] = 0;
+}
+
+static int king_shelter(board_t *board, color_t color, int king_square) {
+  bitboard_t cols = COL_0_BB << SQUARE_COL(king_square);
+  bitboard_t pawns = board->pieces[color][PAWN] & (cols | adjacent_cols(cols));
+  int direction = (color == WHITE) ? 1 : -1;
+  int shelter = 0;
+
+  for (int distance = 1; distance <= 2; distance++) {
+    int row = SQUARE_ROW(king_square) + direction * distance;
+    if (row >= 0 && row <= 7) {
+      shelter += ((distance == 1) ? SHELTER_NEAR : SHELTER_FAR) * pop_count(pawns & ROW_BB(row));
+    }
+  }
+  return shelter;
+}
+
+/*
+ * Shelter depends on the king squares, so it is recomputed whenever they
+ * differ from the ones cached with the pawn terms. A zeroed entry is valid
+ * for the pawnless key 0 since every term is zero without pawns.
+ */
+static pawn_entry_t *probe_pawns(game_t *game, pawn_entry_t *scratch) {
+  board_t *board = &game->position;
+  pawn_entry_t *entry = scratch;
+
+  if (game->pawn_table) {
+    entry = &game->pawn_table->entries[board->pawn_key & (PAWN_TABLE_SIZE - 1)];
+    STATS_INC(pawn_probes);
+    if (entry->key == board->pawn_key) {
+      STATS_INC(pawn_hits);
+    } else {
+      evaluate_pawns(board, entry);
+    }
+  } else {
+    evaluate_pawns(board, entry);
+  }
+  for (int color = WHITE; color <= BLACK; color++) {
+    int king_square = lsb(board->pieces[color][KING]);
+    if (entry->king_squares[color] != king_square) {
+      entry->king_squares[color] = (uint8_t) king_square;
+      entry->shelter[color] = (int16_t) king_shelter(board, (color_t) color, king_square);
+    }
+  }
+  return entry;
+}
+
+static int evaluate_position(game_t *game) {
+  if (game->nnue) {
+    return nnue_evaluate(game);
+  }
+
+  board_t *board = &game->position;
+  int middlegame = 0;
+  int endgame = 0;
+  int phase = 0;
+
+  for (int color = WHITE; color <= BLACK; color++) {
+    int sign = (color == WHITE) ? 1 : -1;
+    for (int piece_type = PAWN; piece_type < KING; piece_type++) {
+      bitboard_t bb = board->pieces[color][piece_type];
+      phase += phase_weights[piece_type] * pop_count(bb);
+      while (bb) {
+        int score = piece_values[piece_type] + piece_square_tables[piece_type][table_index((color_t) color, pop_lsb(&bb))];
+        middlegame += sign * score;
+        endgame += sign * score;
+      }
+    }
+    int king_index = table_index((color_t) color, lsb(board->pieces[color][KING]));
+    middlegame += sign * piece_square_tables[KING][king_index];
+    endgame += sign * king_endgame_table[king_index];
+  }
+
+  pawn_entry_t scratch;
+  pawn_entry_t *pawns = probe_pawns(game, &scratch);
+  middlegame += pawns->middlegame + pawns->shelter[WHITE] - pawns->shelter[BLACK];
+  endgame += pawns->endgame;
+
+  if (phase > TOTAL_PHASE) {
+    phase = TOTAL_PHASE;
+  }
+  int score = (middlegame * phase + endgame * (TOTAL_PHASE - phase)) / TOTAL_PHASE;
+  return (game->color_to_move == WHITE) ? score : -score;
+}
+
+int evaluate(game_t *game) {
+  STATS_TIMER_START(start);
+  int score = evaluate_position(game);
+  STATS_TIMER_STOP(evaluation_ticks, start);
+  return score;
+}
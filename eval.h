@@ -0,0 +1,24 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "game.h"
+
+#define PAWN_TABLE_SIZE 8192
+
+typedef struct pawn_entry {
+  uint64_t key;
+  int16_t middlegame;
+  int16_t endgame;
+  int16_t shelter[2];
+  uint8_t king_squares[2];
+} pawn_entry_t;
+
+struct pawn_table {
+  pawn_entry_t entries[PAWN_TABLE_SIZE];
+};
+
+extern const int piece_values[6];
+
+int evaluate(game_t *game);
+
+#endif
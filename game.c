@@ -1,540 +1,898 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
 #include "game.h"
+#include "nnue.h"
+#include "zobrist.h"
+
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
 
-static int deltas[] = { -1, 1 };
-static int king_deltas[] = { -1, 0, 1 };
-static int knight_deltas[] = { -2, -1, 1, 2 };
+static const piece_type_t back_rank[8] = { ROOK, KNIGHT, BISHOP, KING, QUEEN, BISHOP, KNIGHT, ROOK };
 
-static color_t opposite_color(color_t color) {
+static int castling_masks[64];
+
+ALWAYS_INLINE color_t opposite_color(color_t color) {
   return (color == WHITE) ? BLACK : WHITE;
 }
 
-static int pawn_direction(color_t color) {
-  return (color == WHITE) ? 1 : -1;
+ALWAYS_INLINE bitboard_t pawn_pushes(bitboard_t pawns, color_t color) {
+  return (color == WHITE) ? pawns << 8 : pawns >> 8;
 }
 
-void set_starting_position(board_t *board) {
-  for (int row = 0; row < 8; row++) {
-    for (int col = 0; col < 8; col++) {
-      board->cells[row][col].is_occupied = (row < 2 || row > 5);
+cell_t get_cell(board_t *board, coord_t coord) {
+  bitboard_t bb = SQUARE_BB(SQUARE(coord.row, coord.col));
+  for (int color = WHITE; color <= BLACK; color++) {
+    if (board->occupancy[color] & bb) {
+      for (int piece_type = PAWN; piece_type <= KING; piece_type++) {
+        if (board->pieces[color][piece_type] & bb) {
+          return (cell_t) { true, (piece_t) { (color_t) color, (piece_type_t) piece_type } };
+        }
+      }
     }
   }
+  return (cell_t) { false, (piece_t) { WHITE, PAWN } };
+}
+
+void set_cell(board_t *board, coord_t coord, cell_t cell) {
+  bitboard_t bb = SQUARE_BB(SQUARE(coord.row, coord.col));
+  cell_t previous = get_cell(board, coord);
+  if (previous.is_occupied) {
+    board->material_key -= MATERIAL_UNIT(previous.piece.color, previous.piece.type);
+    if (previous.piece.type == PAWN) {
+      board->pawn_key ^= zobrist_pieces[previous.piece.color][PAWN][SQUARE(coord.row, coord.col)];
+    }
+  }
+  for (int color = WHITE; color <= BLACK; color++) {
+    board->occupancy[color] &= ~bb;
+    for (int piece_type = PAWN; piece_type <= KING; piece_type++) {
+      board->pieces[color][piece_type] &= ~bb;
+    }
+  }
+  if (cell.is_occupied) {
+    board->occupancy[cell.piece.color] |= bb;
+    board->pieces[cell.piece.color][cell.piece.type] |= bb;
+    board->material_key += MATERIAL_UNIT(cell.piece.color, cell.piece.type);
+    if (cell.piece.type == PAWN) {
+      board->pawn_key ^= zobrist_pieces[cell.piece.color][PAWN][SQUARE(coord.row, coord.col)];
+    }
+  }
+}
+
+static void init_castling_masks(void) {
+  static bool initialized = false;
+  if (initialized) {
+    return;
+  }
+  for (int square = 0; square < 64; square++) {
+    castling_masks[square] = ALL_CASTLES;
+  }
+  castling_masks[SQUARE(0, 3)] &= ~(WHITE_KING_SIDE_CASTLE | WHITE_QUEEN_SIDE_CASTLE);
+  castling_masks[SQUARE(0, 0)] &= ~WHITE_KING_SIDE_CASTLE;
+  castling_masks[SQUARE(0, 7)] &= ~WHITE_QUEEN_SIDE_CASTLE;
+  castling_masks[SQUARE(7, 3)] &= ~(BLACK_KING_SIDE_CASTLE | BLACK_QUEEN_SIDE_CASTLE);
+  castling_masks[SQUARE(7, 0)] &= ~BLACK_KING_SIDE_CASTLE;
+  castling_masks[SQUARE(7, 7)] &= ~BLACK_QUEEN_SIDE_CASTLE;
+  initialized = true;
+}
+
+static void put_piece(board_t *board, color_t color, piece_type_t piece_type, int square) {
+  board->pieces[color][piece_type] |= SQUARE_BB(square);
+  board->occupancy[color] |= SQUARE_BB(square);
+  board->material_key += MATERIAL_UNIT(color, piece_type);
+  if (piece_type == PAWN) {
+    board->pawn_key ^= zobrist_pieces[color][PAWN][square];
+  }
+}
+
+static void remove_piece(board_t *board, color_t color, piece_type_t piece_type, int square) {
+  board->pieces[color][piece_type] &= ~SQUARE_BB(square);
+  board->occupancy[color] &= ~SQUARE_BB(square);
+  board->material_key -= MATERIAL_UNIT(color, piece_type);
+  if (piece_type == PAWN) {
+    board->pawn_key ^= zobrist_pieces[color][PAWN][square];
+  }
+}
+
+piece_type_t piece_type_at(board_t *board, color_t color, int square) {
+  for (int piece_type = PAWN; piece_type < KING; piece_type++) {
+    if (board->pieces[color][piece_type] & SQUARE_BB(square)) {
+      return (piece_type_t) piece_type;
+    }
+  }
+  return KING;
+}
+
+static void init_tables(void) {
+  init_bitboards();
+  init_castling_masks();
+  init_zobrist();
+}
+
+void set_starting_position(board_t *board) {
+  init_tables();
+  memset(board, 0, sizeof(board_t));
   for (int col = 0; col < 8; col++) {
-    board->cells[1][col].piece = (piece_t){ WHITE, PAWN };
-    board->cells[6][col].piece = (piece_t){ BLACK, PAWN };
-  }
-  board->cells[0][0].piece = (piece_t){ WHITE, ROOK };
-  board->cells[0][7].piece = (piece_t){ WHITE, ROOK };
-  board->cells[7][0].piece = (piece_t){ BLACK, ROOK };
-  board->cells[7][7].piece = (piece_t){ BLACK, ROOK };
-  board->cells[0][1].piece = (piece_t){ WHITE, KNIGHT };
-  board->cells[0][6].piece = (piece_t){ WHITE, KNIGHT };
-  board->cells[7][1].piece = (piece_t){ BLACK, KNIGHT };
-  board->cells[7][6].piece = (piece_t){ BLACK, KNIGHT };
-  board->cells[0][2].piece = (piece_t){ WHITE, BISHOP };
-  board->cells[0][5].piece = (piece_t){ WHITE, BISHOP };
-  board->cells[7][2].piece = (piece_t){ BLACK, BISHOP };
-  board->cells[7][5].piece = (piece_t){ BLACK, BISHOP };
-  board->cells[0][4].piece = (piece_t){ WHITE, QUEEN };
-  board->cells[0][3].piece = (piece_t){ WHITE, KING };
-  board->cells[7][4].piece = (piece_t){ BLACK, QUEEN };
-  board->cells[7][3].piece = (piece_t){ BLACK, KING };
-}
-
-void init_move_list(move_list_t *move_list) {
-  move_list->count = 0;
-  move_list->capacity = DEFAULT_MOVE_LIST_CAPACITY;
-  move_list->entries = (move_t*)malloc(sizeof(move_t) * DEFAULT_MOVE_LIST_CAPACITY);
+    set_cell(board, (coord_t) { 0, col }, (cell_t) { true, (piece_t) { WHITE, back_rank[col] } });
+    set_cell(board, (coord_t) { 1, col }, (cell_t) { true, (piece_t) { WHITE, PAWN } });
+    set_cell(board, (coord_t) { 6, col }, (cell_t) { true, (piece_t) { BLACK, PAWN } });
+    set_cell(board, (coord_t) { 7, col }, (cell_t) { true, (piece_t) { BLACK, back_rank[col] } });
+  }
+}
+
+static void init_undo_list(undo_list_t *undo_list) {
+  undo_list->count = 0;
+  undo_list->capacity = DEFAULT_UNDO_LIST_CAPACITY;
+  undo_list->entries = (undo_t*)malloc(sizeof(undo_t) * DEFAULT_UNDO_LIST_CAPACITY);
+}
+
+static void push_undo(undo_list_t *undo_list, undo_t undo) {
+  if (undo_list->count == undo_list->capacity) {
+    undo_list->capacity *= 2;
+    undo_list->entries = (undo_t*)realloc(undo_list->entries, sizeof(undo_t) * undo_list->capacity);
+  }
+  undo_list->entries[undo_list->count++] = undo;
 }
 
 void init_game(game_t *game) {
-  init_move_list(&game->moves_made);
+  init_undo_list(&game->undo_stack);
   set_starting_position(&game->position);
+  game->color_to_move = WHITE;
+  game->castling_rights = ALL_CASTLES;
+  game->en_passant_square = NO_SQUARE;
+  game->halfmove_clock = 0;
+  game->plies_since_null = 0;
+  game->fullmove_number = 1;
+  game->key = compute_key(game);
+  game->key_history_count = 0;
+  game->nnue = NULL;
+  game->pawn_table = NULL;
+}
+
+void copy_game(game_t *dest, const game_t *src) {
+  *dest = *src;
+  dest->undo_stack.entries = (undo_t*)malloc(sizeof(undo_t) * src->undo_stack.capacity);
+  memcpy(dest->undo_stack.entries, src->undo_stack.entries, sizeof(undo_t) * src->undo_stack.count);
+  dest->nnue = NULL;
+  dest->pawn_table = NULL;
+}
+
+void free_game(game_t *game) {
+  free(game->undo_stack.entries);
+  game->undo_stack.entries = NULL;
+  game->undo_stack.count = 0;
+  game->undo_stack.capacity = 0;
+  nnue_detach(game);
 }
 
-void add_to_move_list(move_list_t *move_list, move_t move) {
-  if (move_list->count == move_list->capacity) {
-    move_list->capacity *= 2;
-    move_list->entries = (move_t*)realloc(move_list->entries, sizeof(move_t) * move_list->capacity);
+static bool parse_fen(game_t *game, const char *fen) {
+  static const char piece_chars[] = "pnbrqk";
+  board_t *board = &game->position;
+  int row = 7;
+  int col = 7;
+
+  init_tables();
+  game->undo_stack.count = 0;
+  game->key_history_count = 0;
+  memset(board, 0, sizeof(board_t));
+  for (; *fen && *fen != ' '; fen++) {
+    if (*fen == '/') {
+      if (col != -1 || row == 0) {
+        return false;
+      }
+      row--;
+      col = 7;
+    } else if (*fen >= '1' && *fen <= '8') {
+      col -= *fen - '0';
+      if (col < -1) {
+        return false;
+      }
+    } else {
+      const char *piece_char = strchr(piece_chars, tolower((unsigned char) *fen));
+      if (piece_char == NULL || *piece_char == '\0' || col < 0) {
+        return false;
+      }
+      put_piece(board, isupper((unsigned char) *fen) ? WHITE : BLACK, (piece_type_t) (piece_char - piece_chars), SQUARE(row, col));
+      col--;
+    }
+  }
+  if (row != 0 || col != -1 ||
+      pop_count(board->pieces[WHITE][KING]) != 1 ||
+      pop_count(board->pieces[BLACK][KING]) != 1) {
+    return false;
+  }
+
+  while (*fen == ' ') {
+    fen++;
+  }
+  if (*fen == 'w') {
+    game->color_to_move = WHITE;
+  } else if (*fen == 'b') {
+    game->color_to_move = BLACK;
+  } else {
+    return false;
+  }
+  fen++;
+
+  while (*fen == ' ') {
+    fen++;
+  }
+  game->castling_rights = 0;
+  for (; *fen && *fen != ' '; fen++) {
+    switch (*fen) {
+      case 'K': game->castling_rights |= WHITE_KING_SIDE_CASTLE; break;
+      case 'Q': game->castling_rights |= WHITE_QUEEN_SIDE_CASTLE; break;
+      case 'k': game->castling_rights |= BLACK_KING_SIDE_CASTLE; break;
+      case 'q': game->castling_rights |= BLACK_QUEEN_SIDE_CASTLE; break;
+      case '-': break;
+      default: return false;
+    }
+  }
+
+  while (*fen == ' ') {
+    fen++;
+  }
+  game->en_passant_square = NO_SQUARE;
+  if (*fen >= 'a' && *fen <= 'h' && (fen[1] == '3' || fen[1] == '6')) {
+    int square = SQUARE(fen[1] - '1', 7 - (fen[0] - 'a'));
+    if (pawn_attacks[opposite_color(game->color_to_move)][square] & board->pieces[game->color_to_move][PAWN]) {
+      game->en_passant_square = square;
+    }
+    fen += 2;
+  } else if (*fen == '-') {
+    fen++;
+  } else {
+    return false;
+  }
+
+  game->halfmove_clock = 0;
+  while (*fen == ' ') {
+    fen++;
+  }
+  while (*fen >= '0' && *fen <= '9') {
+    game->halfmove_clock = game->halfmove_clock * 10 + (*fen++ - '0');
+  }
+  game->plies_since_null = game->halfmove_clock;
+
+  game->fullmove_number = 0;
+  while (*fen == ' ') {
+    fen++;
   }
-  move_list->entries[move_list->count++] = move;
+  while (*fen >= '0' && *fen <= '9') {
+    game->fullmove_number = game->fullmove_number * 10 + (*fen++ - '0');
+  }
+  if (game->fullmove_number == 0) {
+    game->fullmove_number = 1;
+  }
+  game->key = compute_key(game);
+  return true;
 }
 
-static bool is_valid_coord(coord_t coord) {
-  return (coord.row >= 0) &&
-         (coord.row <= 7) &&
-         (coord.col >= 0) &&
-         (coord.col <= 7);
+bool load_fen(game_t *game, const char *fen) {
+  bool loaded = parse_fen(game, fen);
+  if (game->nnue) {
+    nnue_reset(game->nnue);
+  }
+  return loaded;
 }
 
-bool is_cell_endangered_by_color(board_t *board, coord_t coord, color_t color) {
-  for (int di = 0; di < 2; di++) {
-    coord_t can_coord = (coord_t) {
-      coord.row + (color == WHITE) ? -1 : 1,
-      coord.col + deltas[di]
-    };
-    if (is_valid_coord(can_coord)) {
-      cell_t candidate = board->cells[coord.row][coord.col];
-      if (candidate.is_occupied && candidate.piece.color == color && candidate.piece.type == PAWN) {
-        return true;
+void save_fen(game_t *game, char *fen) {
+  static const char piece_chars[2][7] = { "PNBRQK", "pnbrqk" };
+  board_t *board = &game->position;
+
+  for (int row = 7; row >= 0; row--) {
+    int empty = 0;
+    for (int col = 7; col >= 0; col--) {
+      int square = SQUARE(row, col);
+      color_t color = (board->occupancy[WHITE] & SQUARE_BB(square)) ? WHITE : BLACK;
+      if (!(board->occupancy[color] & SQUARE_BB(square))) {
+        empty++;
+        continue;
       }
+      if (empty) {
+        *fen++ = '0' + empty;
+        empty = 0;
+      }
+      *fen++ = piece_chars[color][piece_type_at(board, color, square)];
+    }
+    if (empty) {
+      *fen++ = '0' + empty;
     }
+    *fen++ = (row > 0) ? '/' : ' ';
   }
-  for (int row_di = 0; row_di < 4; row_di++) {
-    for (int col_di = 0; col_di < 4; col_di++) {
-      coord_t can_coord = (coord_t) {
-        coord.row + knight_deltas[row_di],
-        coord.col + knight_deltas[col_di]
-      };
-      if (abs(knight_deltas[row_di]) != abs(knight_deltas[col_di]) && is_valid_coord(can_coord)) {
-        cell_t candidate = board->cells[coord.row][coord.col];
-        if (candidate.is_occupied && candidate.piece.color == color && candidate.piece.type == KNIGHT) {
-          return true;
-        }
+
+  *fen++ = (game->color_to_move == WHITE) ? 'w' : 'b';
+  *fen++ = ' ';
+  if (game->castling_rights & WHITE_KING_SIDE_CASTLE) {
+    *fen++ = 'K';
+  }
+  if (game->castling_rights & WHITE_QUEEN_SIDE_CASTLE) {
+    *fen++ = 'Q';
+  }
+  if (game->castling_rights & BLACK_KING_SIDE_CASTLE) {
+    *fen++ = 'k';
+  }
+  if (game->castling_rights & BLACK_QUEEN_SIDE_CASTLE) {
+    *fen++ = 'q';
+  }
+  if (game->castling_rights == 0) {
+    *fen++ = '-';
+  }
+  *fen++ = ' ';
+  if (game->en_passant_square != NO_SQUARE) {
+    *fen++ = 'a' + (7 - SQUARE_COL(game->en_passant_square));
+    *fen++ = '1' + SQUARE_ROW(game->en_passant_square);
+  } else {
+    *fen++ = '-';
+  }
+  sprintf(fen, " %d %d", game->halfmove_clock, game->fullmove_number);
+}
+
+void save_snapshot(game_t *game, position_snapshot_t *snapshot) {
+  board_t *board = &game->position;
+
+  memset(snapshot->squares, 0, sizeof(snapshot->squares));
+  for (int color = WHITE; color <= BLACK; color++) {
+    for (int piece_type = PAWN; piece_type <= KING; piece_type++) {
+      bitboard_t bb = board->pieces[color][piece_type];
+      while (bb) {
+        int square = pop_lsb(&bb);
+        snapshot->squares[square >> 1] |= (uint8_t) ((1 + color * 6 + piece_type) << ((square & 1) * 4));
       }
     }
   }
-  for (int row_di = 0; row_di < 2; row_di++) {
-    for (int col_di = 0; col_di < 2; col_di++) {
-      for (int m = 1; m < 8; m++) {
-        coord_t can_coord = (coord_t) {
-          coord.row + m * deltas[row_di],
-          coord.col + m * deltas[col_di]
-        };
-        if (is_valid_coord(can_coord)) {
-          cell_t cell = board->cells[can_coord.row][can_coord.col];
-          if (cell.is_occupied) {
-            if (cell.piece.color == color && (cell.piece.type == BISHOP || cell.piece.type == QUEEN)) {
-              return true;
-            } else {
-              break;
-            }
-          }
-        } else {
-          break;
-        }
+  snapshot->key = game->key;
+  snapshot->fullmove_number = (uint16_t) game->fullmove_number;
+  snapshot->halfmove_clock = (uint16_t) game->halfmove_clock;
+  snapshot->color_to_move = (uint8_t) game->color_to_move;
+  snapshot->castling_rights = (uint8_t) game->castling_rights;
+  snapshot->en_passant_square = (int8_t) game->en_passant_square;
+}
+
+void load_snapshot(game_t *game, const position_snapshot_t *snapshot) {
+  board_t *board = &game->position;
+
+  init_tables();
+  game->undo_stack.count = 0;
+  game->key_history_count = 0;
+  memset(board, 0, sizeof(board_t));
+  for (int square = 0; square < 64; square++) {
+    int code = (snapshot->squares[square >> 1] >> ((square & 1) * 4)) & 15;
+    if (code) {
+      put_piece(board, (color_t) ((code - 1) / 6), (piece_type_t) ((code - 1) % 6), square);
+    }
+  }
+  game->key = snapshot->key;
+  game->fullmove_number = snapshot->fullmove_number;
+  game->halfmove_clock = snapshot->halfmove_clock;
+  game->plies_since_null = snapshot->halfmove_clock;
+  game->color_to_move = (color_t) snapshot->color_to_move;
+  game->castling_rights = snapshot->castling_rights;
+  game->en_passant_square = snapshot->en_passant_square;
+  if (game->nnue) {
+    nnue_reset(game->nnue);
+  }
+}
+
+uint64_t compute_key(game_t *game) {
+  uint64_t key = zobrist_castling[game->castling_rights];
+  for (int color = WHITE; color <= BLACK; color++) {
+    for (int piece_type = PAWN; piece_type <= KING; piece_type++) {
+      bitboard_t bb = game->position.pieces[color][piece_type];
+      while (bb) {
+        key ^= zobrist_pieces[color][piece_type][pop_lsb(&bb)];
       }
     }
   }
-  for (int di = 0; di < 2; di++) {
-    for (int is_row_delta = 0; is_row_delta < 2; is_row_delta++) {
-      for (int m = 1; m < 8; m++) {
-        coord_t can_coord = (coord_t) {
-          coord.row + (is_row_delta == 1) * m * deltas[di],
-          coord.col + (is_row_delta == 0) * m * deltas[di]
-        };
-        if (is_valid_coord(can_coord)) {
-          cell_t cell = board->cells[can_coord.row][can_coord.col];
-          if (cell.is_occupied) {
-            if (cell.piece.color == color && (cell.piece.type == ROOK || cell.piece.type == QUEEN)) {
-              return true;
-            } else {
-              break;
-            }
-          }
-        } else {
-          break;
-        }
+  if (game->en_passant_square != NO_SQUARE) {
+    key ^= zobrist_en_passant[SQUARE_COL(game->en_passant_square)];
+  }
+  if (game->color_to_move == BLACK) {
+    key ^= zobrist_side;
+  }
+  return key;
+}
+
+uint64_t compute_pawn_key(const board_t *board) {
+  uint64_t key = 0;
+  for (int color = WHITE; color <= BLACK; color++) {
+    bitboard_t bb = board->pieces[color][PAWN];
+    while (bb) {
+      key ^= zobrist_pieces[color][PAWN][pop_lsb(&bb)];
+    }
+  }
+  return key;
+}
+
+void move_to_string(move_t move, char *str) {
+  static const char promotion_chars[] = "pnbrqk";
+  str[0] = 'a' + (7 - SQUARE_COL(MOVE_START(move)));
+  str[1] = '1' + SQUARE_ROW(MOVE_START(move));
+  str[2] = 'a' + (7 - SQUARE_COL(MOVE_END(move)));
+  str[3] = '1' + SQUARE_ROW(MOVE_END(move));
+  str[4] = MOVE_IS_PROMOTION(move) ? promotion_chars[MOVE_PROMOTED_PIECE_TYPE(move)] : '\0';
+  str[5] = '\0';
+}
+
+move_t parse_move(game_t *game, const char *str) {
+  move_list_t move_list;
+  char move_str[6];
+
+  init_move_list(&move_list);
+  calculate_legal_moves(game, &move_list);
+  for (int i = 0; i < move_list.count; i++) {
+    move_to_string(move_list.entries[i], move_str);
+    if (strcmp(move_str, str) == 0) {
+      return move_list.entries[i];
+    }
+  }
+  return NO_MOVE;
+}
+
+bitboard_t attackers_to(board_t *board, int square, bitboard_t occupancy) {
+  bitboard_t (*pieces)[6] = board->pieces;
+  return (pawn_attacks[BLACK][square] & pieces[WHITE][PAWN]) |
+         (pawn_attacks[WHITE][square] & pieces[BLACK][PAWN]) |
+         (knight_attacks[square] & (pieces[WHITE][KNIGHT] | pieces[BLACK][KNIGHT])) |
+         (bishop_attacks(square, occupancy) & (pieces[WHITE][BISHOP] | pieces[BLACK][BISHOP] | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN])) |
+         (rook_attacks(square, occupancy) & (pieces[WHITE][ROOK] | pieces[BLACK][ROOK] | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN])) |
+         (king_attacks[square] & (pieces[WHITE][KING] | pieces[BLACK][KING]));
+}
+
+ALWAYS_INLINE bitboard_t attackers_of_color(board_t *board, int square, color_t color, bitboard_t occupancy) {
+  bitboard_t *pieces = board->pieces[color];
+  return (pawn_attacks[opposite_color(color)][square] & pieces[PAWN]) |
+         (knight_attacks[square] & pieces[KNIGHT]) |
+         (bishop_attacks(square, occupancy) & (pieces[BISHOP] | pieces[QUEEN])) |
+         (rook_attacks(square, occupancy) & (pieces[ROOK] | pieces[QUEEN])) |
+         (king_attacks[square] & pieces[KING]);
+}
+
+bool is_square_attacked(board_t *board, int square, color_t color) {
+  return attackers_of_color(board, square, color, board->occupancy[WHITE] | board->occupancy[BLACK]) != 0;
+}
+
+bool is_in_check(game_t *game) {
+  board_t *board = &game->position;
+  int king_square = lsb(board->pieces[game->color_to_move][KING]);
+  return is_square_attacked(board, king_square, opposite_color(game->color_to_move));
+}
+
+int count_repetitions(game_t *game) {
+  int limit = (game->halfmove_clock < game->plies_since_null) ? game->halfmove_clock : game->plies_since_null;
+  int repetitions = 0;
+  if (limit > game->key_history_count) {
+    limit = game->key_history_count;
+  }
+  if (limit > KEY_HISTORY_SIZE) {
+    limit = KEY_HISTORY_SIZE;
+  }
+  for (int i = 4; i <= limit; i += 2) {
+    if (game->key_history[(game->key_history_count - i) & (KEY_HISTORY_SIZE - 1)] == game->key) {
+      repetitions++;
+    }
+  }
+  return repetitions;
+}
+
+bool is_fifty_move_draw(game_t *game) {
+  if (game->halfmove_clock < FIFTY_MOVE_PLIES) {
+    return false;
+  }
+  if (is_in_check(game)) {
+    move_list_t move_list;
+    init_move_list(&move_list);
+    calculate_legal_moves(game, &move_list);
+    return move_list.count > 0;
+  }
+  return true;
+}
+
+bool is_draw(game_t *game) {
+  return count_repetitions(game) >= 2 || is_fifty_move_draw(game);
+}
+
+static void add_piece_moves(move_list_t *move_list, int start, bitboard_t targets) {
+  while (targets) {
+    add_to_move_list(move_list, ENCODE_MOVE(start, pop_lsb(&targets), MOVE_NORMAL));
+  }
+}
+
+static bool is_pinned_off_line(bitboard_t pinned, int king_square, int start, int end) {
+  return (pinned & SQUARE_BB(start)) && !(line_bb[king_square][start] & SQUARE_BB(end));
+}
+
+static void add_pawn_moves(move_list_t *move_list, bitboard_t targets, int offset, bitboard_t pinned, int king_square) {
+  while (targets) {
+    int end = pop_lsb(&targets);
+    if (!is_pinned_off_line(pinned, king_square, end - offset, end)) {
+      add_to_move_list(move_list, ENCODE_MOVE(end - offset, end, MOVE_NORMAL));
+    }
+  }
+}
+
+static void add_promotions(move_list_t *move_list, bitboard_t targets, int offset, bitboard_t pinned, int king_square, piece_type_t first_type, piece_type_t last_type) {
+  while (targets) {
+    int end = pop_lsb(&targets);
+    if (!is_pinned_off_line(pinned, king_square, end - offset, end)) {
+      for (int piece_type = first_type; piece_type >= (int) last_type; piece_type--) {
+        add_to_move_list(move_list, ENCODE_PROMOTION(end - offset, end, piece_type));
       }
     }
   }
-  for (int row_di = 0; row_di < 3; row_di++) {
-    for (int col_di = 0; col_di < 3; col_di++) {
-      if (king_deltas[row_di] != 0 || king_deltas[col_di] != 0) {
-        coord_t can_coord = (coord_t) {
-          coord.row + king_deltas[row_di],
-          coord.col + king_deltas[col_di]
-        };
-        if (is_valid_coord(can_coord)) {
-          cell_t cell = board->cells[can_coord.row][can_coord.col];
-          if (cell.is_occupied && cell.piece.color == color && cell.piece.type == KING) {
-            return true;
-          }
+}
+
+ALWAYS_INLINE bool is_legal_en_passant(board_t *board, color_t color, int start, int end, int captured, int king_square, bitboard_t checkers) {
+  color_t opponent = opposite_color(color);
+  bitboard_t *enemies = board->pieces[opponent];
+  bitboard_t occupancy = ((board->occupancy[WHITE] | board->occupancy[BLACK]) ^ SQUARE_BB(start) ^ SQUARE_BB(captured)) | SQUARE_BB(end);
+  if (checkers & ~SQUARE_BB(captured) & (enemies[PAWN] | enemies[KNIGHT])) {
+    return false;
+  }
+  return !(bishop_attacks(king_square, occupancy) & (enemies[BISHOP] | enemies[QUEEN])) &&
+         !(rook_attacks(king_square, occupancy) & (enemies[ROOK] | enemies[QUEEN]));
+}
+
+ALWAYS_INLINE void generate_color_moves(game_t *game, move_list_t *move_list, int gen_type, bitboard_t start_mask, color_t color_to_move) {
+  color_t opponent = opposite_color(color_to_move);
+  board_t *board = &game->position;
+  bitboard_t *pieces = board->pieces[color_to_move];
+  bitboard_t *enemies = board->pieces[opponent];
+  bitboard_t occupancy = board->occupancy[WHITE] | board->occupancy[BLACK];
+  bitboard_t empty = ~occupancy;
+  int king_square = lsb(pieces[KING]);
+  int forward = (color_to_move == WHITE) ? 8 : -8;
+  int home_row = (color_to_move == WHITE) ? 0 : 7;
+  bitboard_t promotion_row = ROW_BB((color_to_move == WHITE) ? 7 : 0);
+  bitboard_t type_mask = ((gen_type & GEN_CAPTURES) ? board->occupancy[opponent] : 0) |
+                         ((gen_type & GEN_QUIETS) ? empty : 0);
+  bitboard_t bb;
+
+  if (start_mask & SQUARE_BB(king_square)) {
+    bitboard_t king_targets = king_attacks[king_square] & type_mask;
+    bitboard_t occupancy_without_king = occupancy ^ SQUARE_BB(king_square);
+    while (king_targets) {
+      int end = pop_lsb(&king_targets);
+      if (!attackers_of_color(board, end, opponent, occupancy_without_king)) {
+        add_to_move_list(move_list, ENCODE_MOVE(king_square, end, MOVE_NORMAL));
+      }
+    }
+  }
+
+  bitboard_t checkers = attackers_of_color(board, king_square, opponent, occupancy);
+  if (checkers & (checkers - 1)) {
+    return;
+  }
+
+  bitboard_t check_mask = ~0ULL;
+  if (checkers) {
+    check_mask = checkers | between_bb[king_square][lsb(checkers)];
+  } else if ((gen_type & GEN_QUIETS) && (start_mask & SQUARE_BB(king_square))) {
+    bool can_king_side_castle = game->castling_rights & ((color_to_move == WHITE) ? WHITE_KING_SIDE_CASTLE : BLACK_KING_SIDE_CASTLE);
+    bool can_queen_side_castle = game->castling_rights & ((color_to_move == WHITE) ? WHITE_QUEEN_SIDE_CASTLE : BLACK_QUEEN_SIDE_CASTLE);
+    if (can_king_side_castle &&
+        !(occupancy & (SQUARE_BB(SQUARE(home_row, 1)) | SQUARE_BB(SQUARE(home_row, 2)))) &&
+        !attackers_of_color(board, SQUARE(home_row, 2), opponent, occupancy) &&
+        !attackers_of_color(board, SQUARE(home_row, 1), opponent, occupancy)) {
+      add_to_move_list(move_list, ENCODE_MOVE(king_square, SQUARE(home_row, 1), MOVE_KING_SIDE_CASTLE));
+    }
+    if (can_queen_side_castle &&
+        !(occupancy & (SQUARE_BB(SQUARE(home_row, 4)) | SQUARE_BB(SQUARE(home_row, 5)) | SQUARE_BB(SQUARE(home_row, 6)))) &&
+        !attackers_of_color(board, SQUARE(home_row, 4), opponent, occupancy) &&
+        !attackers_of_color(board, SQUARE(home_row, 5), opponent, occupancy)) {
+      add_to_move_list(move_list, ENCODE_MOVE(king_square, SQUARE(home_row, 5), MOVE_QUEEN_SIDE_CASTLE));
+    }
+  }
+
+  bitboard_t pinned = 0;
+  bitboard_t snipers = (bishop_attacks(king_square, board->occupancy[opponent]) & (enemies[BISHOP] | enemies[QUEEN])) |
+                       (rook_attacks(king_square, board->occupancy[opponent]) & (enemies[ROOK] | enemies[QUEEN]));
+  while (snipers) {
+    bitboard_t blockers = between_bb[king_square][pop_lsb(&snipers)] & occupancy;
+    if (!(blockers & (blockers - 1))) {
+      pinned |= blockers & board->occupancy[color_to_move];
+    }
+  }
+
+  bitboard_t targets = type_mask & check_mask;
+  bitboard_t pawns = pieces[PAWN] & start_mask;
+  bitboard_t single_pushes = pawn_pushes(pawns, color_to_move) & empty;
+  bitboard_t double_pushes = pawn_pushes(single_pushes & ROW_BB((color_to_move == WHITE) ? 2 : 5), color_to_move) & empty & check_mask;
+  single_pushes &= check_mask;
+  if (gen_type & GEN_CAPTURES) {
+    bitboard_t right_captures = (pawn_pushes(pawns & ~COL_7_BB, color_to_move) << 1) & board->occupancy[opponent] & check_mask;
+    bitboard_t left_captures = (pawn_pushes(pawns & ~COL_0_BB, color_to_move) >> 1) & board->occupancy[opponent] & check_mask;
+    add_promotions(move_list, right_captures & promotion_row, forward + 1, pinned, king_square, QUEEN, KNIGHT);
+    add_promotions(move_list, left_captures & promotion_row, forward - 1, pinned, king_square, QUEEN, KNIGHT);
+    add_promotions(move_list, single_pushes & promotion_row, forward, pinned, king_square, QUEEN, QUEEN);
+    add_pawn_moves(move_list, right_captures & ~promotion_row, forward + 1, pinned, king_square);
+    add_pawn_moves(move_list, left_captures & ~promotion_row, forward - 1, pinned, king_square);
+
+    if (game->en_passant_square != NO_SQUARE) {
+      int captured = game->en_passant_square - forward;
+      bb = pawn_attacks[opponent][game->en_passant_square] & pawns;
+      while (bb) {
+        int start = pop_lsb(&bb);
+        if (is_legal_en_passant(board, color_to_move, start, game->en_passant_square, captured, king_square, checkers)) {
+          add_to_move_list(move_list, ENCODE_MOVE(start, game->en_passant_square, MOVE_ENPASSANT));
         }
       }
     }
   }
-  return false;
+  if (gen_type & GEN_QUIETS) {
+    add_promotions(move_list, single_pushes & promotion_row, forward, pinned, king_square, ROOK, KNIGHT);
+    add_pawn_moves(move_list, single_pushes & ~promotion_row, forward, pinned, king_square);
+    add_pawn_moves(move_list, double_pushes, forward * 2, pinned, king_square);
+  }
+
+  bb = pieces[KNIGHT] & ~pinned & start_mask;
+  while (bb) {
+    int start = pop_lsb(&bb);
+    add_piece_moves(move_list, start, knight_attacks[start] & targets);
+  }
+
+  bb = pieces[BISHOP] & start_mask;
+  while (bb) {
+    int start = pop_lsb(&bb);
+    bitboard_t moves = bishop_attacks(start, occupancy) & targets;
+    if (pinned & SQUARE_BB(start)) {
+      moves &= line_bb[king_square][start];
+    }
+    add_piece_moves(move_list, start, moves);
+  }
+
+  bb = pieces[ROOK] & start_mask;
+  while (bb) {
+    int start = pop_lsb(&bb);
+    bitboard_t moves = rook_attacks(start, occupancy) & targets;
+    if (pinned & SQUARE_BB(start)) {
+      moves &= line_bb[king_square][start];
+    }
+    add_piece_moves(move_list, start, moves);
+  }
+
+  bb = pieces[QUEEN] & start_mask;
+  while (bb) {
+    int start = pop_lsb(&bb);
+    bitboard_t moves = queen_attacks(start, occupancy) & targets;
+    if (pinned & SQUARE_BB(start)) {
+      moves &= line_bb[king_square][start];
+    }
+    add_piece_moves(move_list, start, moves);
+  }
+}
+
+ALWAYS_INLINE void generate_moves(game_t *game, move_list_t *move_list, int gen_type, bitboard_t start_mask) {
+  if (game->color_to_move == WHITE) {
+    generate_color_moves(game, move_list, gen_type, start_mask, WHITE);
+  } else {
+    generate_color_moves(game, move_list, gen_type, start_mask, BLACK);
+  }
 }
 
 void calculate_legal_moves(game_t *game, move_list_t *move_list) {
-  color_t color_to_move = (game->moves_made.count % 2 == 0) ? WHITE : BLACK;
-  for (int row = 0; row < 8; row++) {
-    for (int col = 0; col < 8; col++) {
-      bool can_king_side_castle;
-      bool can_queen_side_castle;
-      cell_t cell = game->position.cells[row][col];
-      if (cell.is_occupied && cell.piece.color == color_to_move) {
-        switch (cell.piece.type) {
-          case PAWN:
-            if (!game->position.cells[row + pawn_direction(color_to_move)][col].is_occupied) {
-              if ((color_to_move == WHITE && row == 6) || (color_to_move == BLACK && row == 1)) {
-                for (int piece_type = KNIGHT; piece_type <= QUEEN; piece_type++) {
-                  add_to_move_list(
-                    move_list,
-                    (move_t) {
-                      cell.piece,
-                      (coord_t) { row, col },
-                      (coord_t) { row + pawn_direction(color_to_move), col },
-                      false,
-                      false,
-                      false,
-                      (piece_type_t) piece_type
-                    }
-                  );
-                }
-              } else {
-                add_to_move_list(
-                  move_list,
-                  (move_t) {
-                    cell.piece,
-                    (coord_t) { row, col },
-                    (coord_t) { row + pawn_direction(color_to_move), col },
-                    false,
-                    false,
-                    false,
-                    (piece_type_t) 0
-                  }
-                );
-              }
-              if (((color_to_move == WHITE && row == 1) ||
-                  (color_to_move == BLACK && row == 6)) &&
-                  !game->position.cells[row + pawn_direction(color_to_move) * 2][col].is_occupied) {
-                add_to_move_list(
-                  move_list,
-                  (move_t) {
-                    cell.piece,
-                    (coord_t) { row, col },
-                    (coord_t) { row + pawn_direction(color_to_move) * 2, col },
-                    false,
-                    false,
-                    false,
-                    (piece_type_t) 0
-                  }
-                );
-              }
-            }
-            for (int delta_idx = 0; delta_idx < 2; delta_idx++) {
-              coord_t coord = (coord_t) {
-                row + pawn_direction(color_to_move),
-                col + deltas[delta_idx]
-              };
-              if (is_valid_coord(coord)) {
-                cell_t can = game->position.cells[coord.row][coord.col];
-                if (can.is_occupied && can.piece.color == opposite_color(color_to_move)) {
-                  if ((color_to_move == WHITE && row == 6) || (color_to_move == BLACK && row == 1)) {
-                    for (int piece_type = KNIGHT; piece_type <= QUEEN; piece_type++) {
-                      add_to_move_list(
-                        move_list,
-                        (move_t) {
-                          cell.piece,
-                          (coord_t) { row, col },
-                          coord,
-                          false,
-                          false,
-                          false,
-                          (piece_type_t) piece_type
-                        }
-                      );
-                    }
-                  } else {
-                    add_to_move_list(
-                      move_list,
-                      (move_t) {
-                        cell.piece,
-                        (coord_t) { row, col },
-                        coord,
-                        false,
-                        false,
-                        false,
-                        (piece_type_t) 0
-                      }
-                    );
-                  }
-                }
-              }
-            }
-            if (((color_to_move == WHITE && row == 4) || (color_to_move == BLACK && row == 3)) && game->moves_made.count > 0) {
-              move_t previous_move = game->moves_made.entries[game->moves_made.count - 1];
-              if (previous_move.piece.type == PAWN &&
-                  previous_move.piece.color == opposite_color(color_to_move) &&
-                  previous_move.start.row == (color_to_move == WHITE) ? 6 : 1 &&
-                  previous_move.end.row == (color_to_move == WHITE) ? 4 : 3 &&
-                  abs(previous_move.end.col - col) == 1) {
-                add_to_move_list(
-                  move_list,
-                  (move_t) {
-                    cell.piece,
-                    (coord_t) { row, col },
-                    (coord_t) { row + pawn_direction(color_to_move), previous_move.end.col },
-                    true,
-                    false,
-                    false,
-                    (piece_type_t) 0
-                  }
-                );
-              }
-            }
-            break;
-
-          case KNIGHT:
-            for (int row_di = 0; row_di < 4; row_di++) {
-              for (int col_di = 0; col_di < 4; col_di++) {
-                coord_t coord = (coord_t) {
-                  row + knight_deltas[row_di],
-                  col + knight_deltas[col_di]
-                };
-                if (abs(knight_deltas[row_di]) != abs(knight_deltas[col_di]) && is_valid_coord(coord)) {
-                  cell_t can = game->position.cells[coord.row][coord.col];
-                  if (!can.is_occupied || can.piece.color == opposite_color(color_to_move)) {
-                    add_to_move_list(
-                      move_list,
-                      (move_t) {
-                        cell.piece,
-                        (coord_t) { row, col },
-                        coord,
-                        false,
-                        false,
-                        false,
-                        (piece_type_t) 0
-                      }
-                    );
-                  }
-                }
-              }
-            }
-            break;
-
-          case BISHOP:
-            for (int row_di = 0; row_di < 2; row_di++) {
-              for (int col_di = 0; col_di < 2; col_di++) {
-                for (int m = 1; m < 8; m++) {
-                  coord_t coord = (coord_t) {
-                    row + deltas[row_di] * m,
-                    col + deltas[col_di] * m
-                  };
-                  if (is_valid_coord(coord)) {
-                    cell_t can = game->position.cells[coord.row][coord.col];
-                    if (!can.is_occupied || can.piece.color == opposite_color(color_to_move)) {
-                      add_to_move_list(
-                        move_list,
-                        (move_t) {
-                          cell.piece,
-                          (coord_t) { row, col },
-                          coord,
-                          false,
-                          false,
-                          false,
-                          (piece_type_t) 0
-                        }
-                      );
-                      if (can.is_occupied) {
-                        break;
-                      }
-                    } else {
-                      break;
-                    }
-                  } else {
-                    break;
-                  }
-                }
-              }
-            }
-            break;
-
-          case ROOK:
-            for (int di = 0; di < 2; di++) {
-              for (int is_row_delta = 0; is_row_delta < 2; is_row_delta++) {
-                for (int m = 1; m < 8; m++) {
-                  coord_t coord = (coord_t) {
-                    row + deltas[di] * m * (is_row_delta == 1),
-                    col + deltas[di] * m * (is_row_delta == 0)
-                  };
-                  if (is_valid_coord(coord)) {
-                    cell_t can = game->position.cells[coord.row][coord.col];
-                    if (!can.is_occupied || can.piece.color == opposite_color(color_to_move)) {
-                      add_to_move_list(
-                        move_list,
-                        (move_t) {
-                          cell.piece,
-                          (coord_t) { row, col },
-                          coord,
-                          false,
-                          false,
-                          false,
-                          (piece_type_t) 0
-                        }
-                      );
-                      if (can.is_occupied) {
-                        break;
-                      }
-                    } else {
-                      break;
-                    }
-                  } else {
-                    break;
-                  }
-                }
-              }
-            }
-            break;
-
-          case QUEEN:
-            for (int row_di = 0; row_di < 2; row_di++) {
-              for (int col_di = 0; col_di < 2; col_di++) {
-                for (int m = 1; m < 8; m++) {
-                  coord_t coord = (coord_t) {
-                    row + deltas[row_di] * m,
-                    col + deltas[col_di] * m
-                  };
-                  if (is_valid_coord(coord)) {
-                    cell_t can = game->position.cells[coord.row][coord.col];
-                    if (!can.is_occupied || can.piece.color == opposite_color(color_to_move)) {
-                      add_to_move_list(
-                        move_list,
-                        (move_t) {
-                          cell.piece,
-                          (coord_t) { row, col },
-                          coord,
-                          false,
-                          false,
-                          false,
-                          (piece_type_t) 0
-                        }
-                      );
-                      if (can.is_occupied) {
-                        break;
-                      }
-                    } else {
-                      break;
-                    }
-                  } else {
-                    break;
-                  }
-                }
-              }
-            }
-            for (int di = 0; di < 2; di++) {
-              for (int is_row_delta = 0; is_row_delta < 2; is_row_delta++) {
-                for (int m = 1; m < 8; m++) {
-                  coord_t coord = (coord_t) {
-                    row + deltas[di] * m * (is_row_delta == 1),
-                    col + deltas[di] * m * (is_row_delta == 0)
-                  };
-                  if (is_valid_coord(coord)) {
-                    cell_t can = game->position.cells[coord.row][coord.col];
-                    if (!can.is_occupied || can.piece.color == opposite_color(color_to_move)) {
-                      add_to_move_list(
-                        move_list,
-                        (move_t) {
-                          cell.piece,
-                          (coord_t) { row, col },
-                          coord,
-                          false,
-                          false,
-                          false,
-                          (piece_type_t) 0
-                        }
-                      );
-                      if (can.is_occupied) {
-                        break;
-                      }
-                    } else {
-                      break;
-                    }
-                  } else {
-                    break;
-                  }
-                }
-              }
-            }
-            break;
-
-          case KING:
-            for (int row_di = 0; row_di < 3; row_di++) {
-              for (int col_di = 0; col_di < 3; col_di++) {
-                coord_t coord = (coord_t) {
-                  row + king_deltas[row_di],
-                  col + king_deltas[col_di]
-                };
-                if ((king_deltas[row_di] != 0 || king_deltas[col_di] != 0) && is_valid_coord(coord)) {
-                  cell_t can = game->position.cells[coord.row][coord.col];
-                  if (!can.is_occupied || can.piece.color == opposite_color(color_to_move)) {
-                    add_to_move_list(
-                      move_list,
-                      (move_t) {
-                        cell.piece,
-                        (coord_t) { row, col },
-                        coord,
-                        false,
-                        false,
-                        false,
-                        (piece_type_t) 0
-                      }
-                    );
-                  }
-                }
-              }
-            }
-            can_king_side_castle = true;
-            can_queen_side_castle = true;
-            for (int move_idx = 0; move_idx < game->moves_made.count; move_idx++) {
-              move_t move = game->moves_made.entries[move_idx];
-              if (move.piece.color == color_to_move) {
-                if (move.is_king_side_castle || move.is_queen_side_castle || move.piece.type == KING) {
-                  can_king_side_castle = false;
-                  can_queen_side_castle = false;
-                } else if (move.piece.type == ROOK && ((move.start.row == 0 && color_to_move == WHITE) || (move.start.row == 7 && color_to_move == BLACK))) {
-                  if (move.start.col == 0) {
-                    can_king_side_castle = false;
-                  } else if (move.start.col = 7) {
-                    can_queen_side_castle = false;
-                  }
-                }
-                if (!can_king_side_castle && !can_queen_side_castle) {
-                  break;
-                }
-              }
-            }
-            if (can_king_side_castle &&
-                !game->position.cells[(color_to_move == WHITE) ? 0 : 7][1].is_occupied &&
-                !game->position.cells[(color_to_move == WHITE) ? 0 : 7][2].is_occupied &&
-                !is_cell_endangered_by_color(&game->position, (coord_t) { row, 2 }, opposite_color(color_to_move)) &&
-                !is_cell_endangered_by_color(&game->position, (coord_t) { row, col }, opposite_color(color_to_move))) {
-              add_to_move_list(
-                move_list,
-                (move_t) {
-                  cell.piece,
-                  (coord_t) { row, col },
-                  (coord_t) { row, 1 },
-                  false,
-                  true,
-                  false,
-                  (piece_type_t) 0
-                }
-              );
-            }
-            if (can_queen_side_castle &&
-                !game->position.cells[(color_to_move == WHITE) ? 0 : 7][4].is_occupied &&
-                !game->position.cells[(color_to_move == WHITE) ? 0 : 7][5].is_occupied &&
-                !game->position.cells[(color_to_move == WHITE) ? 0 : 7][6].is_occupied &&
-                !is_cell_endangered_by_color(&game->position, (coord_t) { row, 4 }, opposite_color(color_to_move)) &&
-                !is_cell_endangered_by_color(&game->position, (coord_t) { row, col }, opposite_color(color_to_move))) {
-              add_to_move_list(
-                move_list,
-                (move_t) {
-                  cell.piece,
-                  (coord_t) { row, col },
-                  (coord_t) { row, 5 },
-                  false,
-                  false,
-                  true,
-                  (piece_type_t) 0
-                }
-              );
-            }
-            break;
-        }
-      }
+  generate_moves(game, move_list, GEN_ALL, ~0ULL);
+}
+
+void calculate_captures(game_t *game, move_list_t *move_list) {
+  generate_moves(game, move_list, GEN_CAPTURES, ~0ULL);
+}
+
+void calculate_quiet_moves(game_t *game, move_list_t *move_list) {
+  generate_moves(game, move_list, GEN_QUIETS, ~0ULL);
+}
+
+bool is_legal_move(game_t *game, move_t move) {
+  move_list_t move_list;
+  if (move == NO_MOVE || !(game->position.occupancy[game->color_to_move] & SQUARE_BB(MOVE_START(move)))) {
+    return false;
+  }
+  init_move_list(&move_list);
+  generate_moves(game, &move_list, GEN_ALL, SQUARE_BB(MOVE_START(move)));
+  for (int i = 0; i < move_list.count; i++) {
+    if (move_list.entries[i] == move) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool is_capture_move(game_t *game, move_t move) {
+  return MOVE_FLAGS(move) == MOVE_ENPASSANT ||
+         (game->position.occupancy[opposite_color(game->color_to_move)] & SQUARE_BB(MOVE_END(move)));
+}
+
+ALWAYS_INLINE void make_color_move(game_t *game, move_t move, color_t color) {
+  board_t *board = &game->position;
+  color_t opponent = opposite_color(color);
+  int start = MOVE_START(move);
+  int end = MOVE_END(move);
+  int flags = MOVE_FLAGS(move);
+  piece_type_t piece_type = piece_type_at(board, color, start);
+  uint64_t key = game->key ^ zobrist_side ^ zobrist_castling[game->castling_rights];
+  undo_t undo = {
+    game->key,
+    move,
+    -1,
+    (uint8_t) game->castling_rights,
+    (int8_t) game->en_passant_square,
+    (uint16_t) game->halfmove_clock,
+    (uint16_t) game->plies_since_null
+  };
+
+  piece_type_t end_piece_type = MOVE_IS_PROMOTION(move) ? MOVE_PROMOTED_PIECE_TYPE(move) : piece_type;
+
+  if (game->en_passant_square != NO_SQUARE) {
+    key ^= zobrist_en_passant[SQUARE_COL(game->en_passant_square)];
+  }
+  if (flags == MOVE_ENPASSANT) {
+    int captured = SQUARE(SQUARE_ROW(start), SQUARE_COL(end));
+    remove_piece(board, opponent, PAWN, captured);
+    key ^= zobrist_pieces[opponent][PAWN][captured];
+    undo.captured_piece_type = PAWN;
+  } else if (board->occupancy[opponent] & SQUARE_BB(end)) {
+    undo.captured_piece_type = piece_type_at(board, opponent, end);
+    remove_piece(board, opponent, (piece_type_t) undo.captured_piece_type, end);
+    key ^= zobrist_pieces[opponent][undo.captured_piece_type][end];
+  }
+  remove_piece(board, color, piece_type, start);
+  put_piece(board, color, end_piece_type, end);
+  key ^= zobrist_pieces[color][piece_type][start] ^ zobrist_pieces[color][end_piece_type][end];
+  if (flags == MOVE_KING_SIDE_CASTLE) {
+    remove_piece(board, color, ROOK, start - 3);
+    put_piece(board, color, ROOK, start - 1);
+    key ^= zobrist_pieces[color][ROOK][start - 3] ^ zobrist_pieces[color][ROOK][start - 1];
+  } else if (flags == MOVE_QUEEN_SIDE_CASTLE) {
+    remove_piece(board, color, ROOK, start + 4);
+    put_piece(board, color, ROOK, start + 1);
+    key ^= zobrist_pieces[color][ROOK][start + 4] ^ zobrist_pieces[color][ROOK][start + 1];
+  }
+
+  if (game->nnue) {
+    dirty_piece_t *dirty = nnue_push(game->nnue);
+    if (MOVE_IS_PROMOTION(move)) {
+      add_dirty_piece(dirty, color, PAWN, start, NO_SQUARE);
+      add_dirty_piece(dirty, color, end_piece_type, NO_SQUARE, end);
+    } else {
+      add_dirty_piece(dirty, color, piece_type, start, end);
     }
+    if (flags == MOVE_ENPASSANT) {
+      add_dirty_piece(dirty, opponent, PAWN, SQUARE(SQUARE_ROW(start), SQUARE_COL(end)), NO_SQUARE);
+    } else if (undo.captured_piece_type != -1) {
+      add_dirty_piece(dirty, opponent, (piece_type_t) undo.captured_piece_type, end, NO_SQUARE);
+    } else if (flags == MOVE_KING_SIDE_CASTLE) {
+      add_dirty_piece(dirty, color, ROOK, start - 3, start - 1);
+    } else if (flags == MOVE_QUEEN_SIDE_CASTLE) {
+      add_dirty_piece(dirty, color, ROOK, start + 4, start + 1);
+    }
+  }
+
+  game->castling_rights &= castling_masks[start] & castling_masks[end];
+  key ^= zobrist_castling[game->castling_rights];
+  game->en_passant_square = NO_SQUARE;
+  if (piece_type == PAWN && abs(end - start) == 16 &&
+      (pawn_attacks[color][(start + end) / 2] & board->pieces[opponent][PAWN])) {
+    game->en_passant_square = (start + end) / 2;
+    key ^= zobrist_en_passant[SQUARE_COL(game->en_passant_square)];
+  }
+  if (piece_type == PAWN || undo.captured_piece_type != -1) {
+    game->halfmove_clock = 0;
+  } else {
+    game->halfmove_clock++;
+  }
+  game->plies_since_null++;
+  if (color == BLACK) {
+    game->fullmove_number++;
+  }
+  game->color_to_move = opponent;
+  game->key_history[game->key_history_count++ & (KEY_HISTORY_SIZE - 1)] = game->key;
+  game->key = key;
+
+  push_undo(&game->undo_stack, undo);
+}
+
+void make_move(game_t *game, move_t move) {
+  if (game->color_to_move == WHITE) {
+    make_color_move(game, move, WHITE);
+  } else {
+    make_color_move(game, move, BLACK);
+  }
+}
+
+ALWAYS_INLINE void unmake_color_move(game_t *game, color_t color) {
+  board_t *board = &game->position;
+  undo_t undo = game->undo_stack.entries[--game->undo_stack.count];
+  move_t move = undo.move;
+  color_t opponent = opposite_color(color);
+  int start = MOVE_START(move);
+  int end = MOVE_END(move);
+  int flags = MOVE_FLAGS(move);
+
+  if (flags == MOVE_KING_SIDE_CASTLE) {
+    remove_piece(board, color, ROOK, start - 1);
+    put_piece(board, color, ROOK, start - 3);
+  } else if (flags == MOVE_QUEEN_SIDE_CASTLE) {
+    remove_piece(board, color, ROOK, start + 1);
+    put_piece(board, color, ROOK, start + 4);
+  }
+  if (MOVE_IS_PROMOTION(move)) {
+    remove_piece(board, color, MOVE_PROMOTED_PIECE_TYPE(move), end);
+    put_piece(board, color, PAWN, start);
+  } else {
+    piece_type_t piece_type = piece_type_at(board, color, end);
+    remove_piece(board, color, piece_type, end);
+    put_piece(board, color, piece_type, start);
+  }
+  if (flags == MOVE_ENPASSANT) {
+    put_piece(board, opponent, PAWN, SQUARE(SQUARE_ROW(start), SQUARE_COL(end)));
+  } else if (undo.captured_piece_type != -1) {
+    put_piece(board, opponent, (piece_type_t) undo.captured_piece_type, end);
+  }
+
+  game->castling_rights = undo.castling_rights;
+  game->en_passant_square = undo.en_passant_square;
+  game->halfmove_clock = undo.halfmove_clock;
+  game->plies_since_null = undo.plies_since_null;
+  if (color == BLACK) {
+    game->fullmove_number--;
+  }
+  game->color_to_move = color;
+  game->key_history_count--;
+  game->key = undo.key;
+  if (game->nnue) {
+    nnue_pop(game->nnue);
+  }
+}
+
+void unmake_move(game_t *game) {
+  if (game->color_to_move == WHITE) {
+    unmake_color_move(game, BLACK);
+  } else {
+    unmake_color_move(game, WHITE);
+  }
+}
+
+void make_null_move(game_t *game) {
+  undo_t undo = {
+    game->key,
+    NO_MOVE,
+    -1,
+    (uint8_t) game->castling_rights,
+    (int8_t) game->en_passant_square,
+    (uint16_t) game->halfmove_clock,
+    (uint16_t) game->plies_since_null
+  };
+
+  game->key ^= zobrist_side;
+  if (game->en_passant_square != NO_SQUARE) {
+    game->key ^= zobrist_en_passant[SQUARE_COL(game->en_passant_square)];
+    game->en_passant_square = NO_SQUARE;
+  }
+  game->plies_since_null = 0;
+  if (game->color_to_move == BLACK) {
+    game->fullmove_number++;
+  }
+  game->color_to_move = opposite_color(game->color_to_move);
+  game->key_history[game->key_history_count++ & (KEY_HISTORY_SIZE - 1)] = undo.key;
+  if (game->nnue) {
+    nnue_push(game->nnue);
+  }
+
+  push_undo(&game->undo_stack, undo);
+}
+
+void unmake_null_move(game_t *game) {
+  undo_t undo = game->undo_stack.entries[--game->undo_stack.count];
+
+  game->en_passant_square = undo.en_passant_square;
+  game->plies_since_null = undo.plies_since_null;
+  game->color_to_move = opposite_color(game->color_to_move);
+  if (game->color_to_move == BLACK) {
+    game->fullmove_number--;
+  }
+  game->key_history_count--;
+  game->key = undo.key;
+  if (game->nnue) {
+    nnue_pop(game->nnue);
   }
 }
@@ -1,11 +1,49 @@
 #ifndef GAME_H
 #define GAME_H
 
-#define DEFAULT_MOVE_LIST_CAPACITY 100
+#define MAX_MOVES 218
+#define MAX_FEN_LENGTH 92
+#define DEFAULT_UNDO_LIST_CAPACITY 100
+#define KEY_HISTORY_SIZE 256
+#define FIFTY_MOVE_PLIES 100
+
+#define WHITE_KING_SIDE_CASTLE 1
+#define WHITE_QUEEN_SIDE_CASTLE 2
+#define BLACK_KING_SIDE_CASTLE 4
+#define BLACK_QUEEN_SIDE_CASTLE 8
+#define ALL_CASTLES 15
+
+#define NO_SQUARE -1
+
+#define MATERIAL_SHIFT(color, piece_type) (4 * ((color) * 6 + (piece_type)))
+#define MATERIAL_UNIT(color, piece_type) (1ULL << MATERIAL_SHIFT(color, piece_type))
+#define MATERIAL_COUNT(material_key, color, piece_type) ((int) (((material_key) >> MATERIAL_SHIFT(color, piece_type)) & 15))
+
+#define NO_MOVE 0
+
+#define MOVE_NORMAL 0
+#define MOVE_ENPASSANT 1
+#define MOVE_KING_SIDE_CASTLE 2
+#define MOVE_QUEEN_SIDE_CASTLE 3
+#define MOVE_PROMOTION 4
+
+#define GEN_CAPTURES 1
+#define GEN_QUIETS 2
+#define GEN_ALL (GEN_CAPTURES | GEN_QUIETS)
+
+#define ENCODE_MOVE(start, end, flags) ((move_t) ((start) | ((end) << 6) | ((flags) << 12)))
+#define ENCODE_PROMOTION(start, end, piece_type) ENCODE_MOVE(start, end, MOVE_PROMOTION | ((piece_type) - KNIGHT))
+#define MOVE_START(move) ((move) & 63)
+#define MOVE_END(move) (((move) >> 6) & 63)
+#define MOVE_FLAGS(move) ((move) >> 12)
+#define MOVE_IS_PROMOTION(move) (MOVE_FLAGS(move) & MOVE_PROMOTION)
+#define MOVE_PROMOTED_PIECE_TYPE(move) ((piece_type_t) (MOVE_IS_PROMOTION(move) ? (MOVE_FLAGS(move) & 3) + KNIGHT : PAWN))
 
 #include <stdbool.h>
 #include <stdlib.h>
 
+#include "bitboard.h"
+
 typedef enum color {
   WHITE,
   BLACK
@@ -31,7 +69,10 @@ typedef struct cell {
 } cell_t;
 
 typedef struct board {
-  cell_t cells[8][8];
+  bitboard_t pieces[2][6];
+  bitboard_t occupancy[2];
+  uint64_t material_key;
+  uint64_t pawn_key;
 } board_t;
 
 typedef struct coord {
@@ -39,31 +80,99 @@ typedef struct coord {
   int col;
 } coord_t;
 
-typedef struct move {
-  piece_t piece;
-  coord_t start;
-  coord_t end;
-  bool is_enpassant;
-  bool is_king_side_castle;
-  bool is_queen_side_castle;
-  piece_type_t promoted_piece_type;
-} move_t;
+typedef uint16_t move_t;
 
 typedef struct move_list {
   int count;
-  int capacity;
-  move_t *entries;
+  move_t entries[MAX_MOVES];
 } move_list_t;
 
+typedef struct undo {
+  uint64_t key;
+  move_t move;
+  int8_t captured_piece_type;
+  uint8_t castling_rights;
+  int8_t en_passant_square;
+  uint16_t halfmove_clock;
+  uint16_t plies_since_null;
+} undo_t;
+
+typedef struct undo_list {
+  int count;
+  int capacity;
+  undo_t *entries;
+} undo_list_t;
+
+typedef struct position_snapshot {
+  uint64_t key;
+  uint8_t squares[32];
+  uint16_t fullmove_number;
+  uint16_t halfmove_clock;
+  uint8_t color_to_move;
+  uint8_t castling_rights;
+  int8_t en_passant_square;
+} position_snapshot_t;
+
+typedef struct nnue_stack nnue_stack_t;
+typedef struct pawn_table pawn_table_t;
+
 typedef struct game {
-  move_list_t moves_made;
+  undo_list_t undo_stack;
+  nnue_stack_t *nnue;
+  pawn_table_t *pawn_table;
   board_t position;
+  uint64_t key;
+  color_t color_to_move;
+  int castling_rights;
+  int en_passant_square;
+  int halfmove_clock;
+  int plies_since_null;
+  int fullmove_number;
+  int key_history_count;
+  uint64_t key_history[KEY_HISTORY_SIZE];
 } game_t;
 
 void init_game(game_t *game);
+void copy_game(game_t *dest, const game_t *src);
+void free_game(game_t *game);
 void set_starting_position(board_t *board);
-void init_move_list(move_list_t *move_list);
-void add_to_move_list(move_list_t *move_list, move_t move);
+cell_t get_cell(board_t *board, coord_t coord);
+void set_cell(board_t *board, coord_t coord, cell_t cell);
+piece_type_t piece_type_at(board_t *board, color_t color, int square);
+bool load_fen(game_t *game, const char *fen);
+void save_fen(game_t *game, char *fen);
+void save_snapshot(game_t *game, position_snapshot_t *snapshot);
+void load_snapshot(game_t *game, const position_snapshot_t *snapshot);
+void move_to_string(move_t move, char *str);
+move_t parse_move(game_t *game, const char *str);
+uint64_t compute_key(game_t *game);
+uint64_t compute_pawn_key(const board_t *board);
 void calculate_legal_moves(game_t *game, move_list_t *move_list);
+void calculate_captures(game_t *game, move_list_t *move_list);
+void calculate_quiet_moves(game_t *game, move_list_t *move_list);
+bool is_legal_move(game_t *game, move_t move);
+bool is_capture_move(game_t *game, move_t move);
+bitboard_t attackers_to(board_t *board, int square, bitboard_t occupancy);
+bool is_square_attacked(board_t *board, int square, color_t color);
+bool is_in_check(game_t *game);
+int count_repetitions(game_t *game);
+bool is_fifty_move_draw(game_t *game);
+bool is_draw(game_t *game);
+void make_move(game_t *game, move_t move);
+void unmake_move(game_t *game);
+void make_null_move(game_t *game);
+void unmake_null_move(game_t *game);
+
+static inline int piece_count(board_t *board) {
+  return pop_count(board->occupancy[WHITE] | board->occupancy[BLACK]);
+}
+
+static inline void init_move_list(move_list_t *move_list) {
+  move_list->count = 0;
+}
+
+static inline void add_to_move_list(move_list_t *move_list, move_t move) {
+  move_list->entries[move_list->count++] = move;
+}
 
 #endif
@@ -0,0 +1,238 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "match.h"
+#include "tt.h"
+
+#define STARTING_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+#define DEFAULT_MAX_PLIES 400
+#define MIN_SCORE 1e-6
+
+#define OUTCOME_LOSS 0
+#define OUTCOME_DRAW 1
+#define OUTCOME_WIN 2
+
+typedef struct opening_list {
+  int count;
+  int capacity;
+  char **entries;
+} opening_list_t;
+
+typedef struct match_runner match_runner_t;
+
+typedef struct match_worker {
+  match_runner_t *runner;
+  pthread_t thread;
+  game_t game;
+  transposition_table_t tables[2];
+  search_limits_t limits[2];
+} match_worker_t;
+
+struct match_runner {
+  const match_config_t *config;
+  opening_list_t openings;
+  atomic_int next_game;
+  atomic_bool finished;
+  pthread_mutex_t mutex;
+  match_stats_t stats;
+};
+
+static void add_opening(opening_list_t *openings, const char *fen) {
+  if (openings->count == openings->capacity) {
+    openings->capacity = openings->capacity ? openings->capacity * 2 : 64;
+    openings->entries = (char**)realloc(openings->entries, openings->capacity * sizeof(char*));
+  }
+  openings->entries[openings->count++] = strdup(fen);
+}
+
+static bool load_openings(opening_list_t *openings, const char *path) {
+  game_t game;
+  char *line = NULL;
+  size_t capacity = 0;
+
+  if (path == NULL) {
+    add_opening(openings, STARTING_FEN);
+    return true;
+  }
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    return false;
+  }
+  init_game(&game);
+  while (getline(&line, &capacity, file) != -1) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] != '\0' && line[0] != '#' && load_fen(&game, line)) {
+      add_opening(openings, line);
+    }
+  }
+  free_game(&game);
+  free(line);
+  fclose(file);
+  return openings->count > 0;
+}
+
+static void free_openings(opening_list_t *openings) {
+  for (int i = 0; i < openings->count; i++) {
+    free(openings->entries[i]);
+  }
+  free(openings->entries);
+}
+
+static bool is_insufficient_material(board_t *board) {
+  if (piece_count(board) > 3) {
+    return false;
+  }
+  return !(board->pieces[WHITE][PAWN] | board->pieces[BLACK][PAWN] |
+           board->pieces[WHITE][ROOK] | board->pieces[BLACK][ROOK] |
+           board->pieces[WHITE][QUEEN] | board->pieces[BLACK][QUEEN]);
+}
+
+static int play_game(match_worker_t *worker, const char *opening, int white_player) {
+  const match_config_t *config = worker->runner->config;
+  game_t *game = &worker->game;
+  int max_plies = (config->max_plies > 0) ? config->max_plies : DEFAULT_MAX_PLIES;
+  move_list_t move_list;
+
+  load_fen(game, opening);
+  tt_clear(&worker->tables[0]);
+  tt_clear(&worker->tables[1]);
+  for (int ply = 0; ; ply++) {
+    int mover = (game->color_to_move == WHITE) ? white_player : !white_player;
+    init_move_list(&move_list);
+    calculate_legal_moves(game, &move_list);
+    if (move_list.count == 0) {
+      if (!is_in_check(game)) {
+        return OUTCOME_DRAW;
+      }
+      return (mover == 0) ? OUTCOME_LOSS : OUTCOME_WIN;
+    }
+    if (is_draw(game) || is_insufficient_material(&game->position) || ply >= max_plies) {
+      return OUTCOME_DRAW;
+    }
+
+    const match_player_t *player = &config->players[mover];
+    search_result_t result = player->search(game, &worker->limits[mover]);
+    move_t move = is_legal_move(game, result.best_move) ? result.best_move : move_list.entries[0];
+    make_move(game, move);
+  }
+}
+
+static double score_to_elo(double score) {
+  if (score < MIN_SCORE) {
+    score = MIN_SCORE;
+  } else if (score > 1 - MIN_SCORE) {
+    score = 1 - MIN_SCORE;
+  }
+  return -400 * log10(1 / score - 1);
+}
+
+static double elo_to_score(double elo) {
+  return 1 / (1 + pow(10, -elo / 400));
+}
+
+static void update_statistics(const match_config_t *config, match_stats_t *stats) {
+  int games = stats->wins + stats->draws + stats->losses;
+  double score = (stats->wins + 0.5 * stats->draws) / games;
+  double variance = (stats->wins * (1 - score) * (1 - score) +
+                     stats->draws * (0.5 - score) * (0.5 - score) +
+                     stats->losses * score * score) / games;
+  double margin = 1.96 * sqrt(variance / games);
+
+  stats->elo = score_to_elo(score);
+  stats->elo_error = (score_to_elo(score + margin) - score_to_elo(score - margin)) / 2;
+  if (!config->sprt || variance <= 0) {
+    return;
+  }
+  double score0 = elo_to_score(config->elo0);
+  double score1 = elo_to_score(config->elo1);
+  stats->llr = (score1 - score0) * (2 * score - score0 - score1) * games / (2 * variance);
+  if (stats->llr >= stats->upper_bound) {
+    stats->sprt_result = SPRT_ACCEPT_H1;
+  } else if (stats->llr <= stats->lower_bound) {
+    stats->sprt_result = SPRT_ACCEPT_H0;
+  }
+}
+
+static void *match_worker_thread(void *arg) {
+  match_worker_t *worker = (match_worker_t*) arg;
+  match_runner_t *runner = worker->runner;
+  const match_config_t *config = runner->config;
+  int index;
+
+  while (!atomic_load_explicit(&runner->finished, memory_order_relaxed) &&
+         (index = atomic_fetch_add_explicit(&runner->next_game, 1, memory_order_relaxed)) < config->games) {
+    const char *opening = runner->openings.entries[(index / 2) % runner->openings.count];
+    int outcome = play_game(worker, opening, index & 1);
+
+    pthread_mutex_lock(&runner->mutex);
+    match_stats_t *stats = &runner->stats;
+    if (outcome == OUTCOME_WIN) {
+      stats->wins++;
+    } else if (outcome == OUTCOME_LOSS) {
+      stats->losses++;
+    } else {
+      stats->draws++;
+    }
+    update_statistics(config, stats);
+    if (stats->sprt_result != SPRT_CONTINUE) {
+      atomic_store_explicit(&runner->finished, true, memory_order_relaxed);
+    }
+    if (config->progress) {
+      config->progress(stats, config->progress_arg);
+    }
+    pthread_mutex_unlock(&runner->mutex);
+  }
+  return NULL;
+}
+
+bool run_match(const match_config_t *config, match_stats_t *stats) {
+  match_runner_t runner;
+  int thread_count = (config->threads > 1) ? config->threads : 1;
+
+  memset(&runner, 0, sizeof(runner));
+  if (!load_openings(&runner.openings, config->openings_path)) {
+    free_openings(&runner.openings);
+    return false;
+  }
+  runner.config = config;
+  atomic_init(&runner.next_game, 0);
+  atomic_init(&runner.finished, false);
+  pthread_mutex_init(&runner.mutex, NULL);
+  if (config->sprt) {
+    runner.stats.lower_bound = log(config->beta / (1 - config->alpha));
+    runner.stats.upper_bound = log((1 - config->beta) / config->alpha);
+  }
+
+  match_worker_t *workers = (match_worker_t*)calloc(thread_count, sizeof(match_worker_t));
+  for (int i = 0; i < thread_count; i++) {
+    workers[i].runner = &runner;
+    init_game(&workers[i].game);
+    for (int p = 0; p < 2; p++) {
+      const match_player_t *player = &config->players[p];
+      tt_resize(&workers[i].tables[p], (player->hash_mb > 0) ? player->hash_mb : DEFAULT_TT_SIZE_MB);
+      workers[i].limits[p] = player->limits;
+      workers[i].limits[p].tt = &workers[i].tables[p];
+    }
+  }
+  for (int i = 1; i < thread_count; i++) {
+    pthread_create(&workers[i].thread, NULL, match_worker_thread, &workers[i]);
+  }
+  match_worker_thread(&workers[0]);
+  for (int i = 0; i < thread_count; i++) {
+    if (i > 0) {
+      pthread_join(workers[i].thread, NULL);
+    }
+    free_game(&workers[i].game);
+    tt_free(&workers[i].tables[0]);
+    tt_free(&workers[i].tables[1]);
+  }
+
+  *stats = runner.stats;
+  free(workers);
+  free_openings(&runner.openings);
+  pthread_mutex_destroy(&runner.mutex);
+  return true;
+}
@@ -0,0 +1,53 @@
+#ifndef MATCH_H
+#define MATCH_H
+
+#include "search.h"
+
+#define SPRT_CONTINUE 0
+#define SPRT_ACCEPT_H0 -1
+#define SPRT_ACCEPT_H1 1
+
+typedef search_result_t (*match_search_t)(game_t *game, const search_limits_t *limits);
+
+/*
+ * Each worker gives each player its own transposition table of hash_mb
+ * megabytes (DEFAULT_TT_SIZE_MB when zero), overriding limits.tt.
+ */
+typedef struct match_player {
+  match_search_t search;
+  search_limits_t limits;
+  int hash_mb;
+} match_player_t;
+
+typedef struct match_stats {
+  int wins;
+  int draws;
+  int losses;
+  double elo;
+  double elo_error;
+  double llr;
+  double lower_bound;
+  double upper_bound;
+  int sprt_result;
+} match_stats_t;
+
+typedef void (*match_progress_t)(const match_stats_t *stats, void *arg);
+
+typedef struct match_config {
+  match_player_t players[2];
+  const char *openings_path;
+  int games;
+  int threads;
+  int max_plies;
+  bool sprt;
+  double elo0;
+  double elo1;
+  double alpha;
+  double beta;
+  match_progress_t progress;
+  void *progress_arg;
+} match_config_t;
+
+bool run_match(const match_config_t *config, match_stats_t *stats);
+
+#endif
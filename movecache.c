@@ -0,0 +1,145 @@
+#include <string.h>
+
+#include "movecache.h"
+
+#define SHARD_INDEX(key) ((key) >> 58)
+
+static void unlink_entry(move_cache_shard_t *shard, uint32_t index) {
+  move_cache_entry_t *entry = &shard->entries[index];
+  if (entry->newer != NO_CACHE_ENTRY) {
+    shard->entries[entry->newer].older = entry->older;
+  } else {
+    shard->newest = entry->older;
+  }
+  if (entry->older != NO_CACHE_ENTRY) {
+    shard->entries[entry->older].newer = entry->newer;
+  } else {
+    shard->oldest = entry->newer;
+  }
+}
+
+static void push_newest(move_cache_shard_t *shard, uint32_t index) {
+  move_cache_entry_t *entry = &shard->entries[index];
+  entry->newer = NO_CACHE_ENTRY;
+  entry->older = shard->newest;
+  if (shard->newest != NO_CACHE_ENTRY) {
+    shard->entries[shard->newest].newer = index;
+  } else {
+    shard->oldest = index;
+  }
+  shard->newest = index;
+}
+
+static uint32_t find_entry(move_cache_shard_t *shard, uint64_t key) {
+  uint32_t index = shard->buckets[key & shard->bucket_mask];
+  while (index != NO_CACHE_ENTRY && shard->entries[index].key != key) {
+    index = shard->entries[index].chain;
+  }
+  return index;
+}
+
+static void remove_from_chain(move_cache_shard_t *shard, uint32_t index) {
+  uint32_t *link = &shard->buckets[shard->entries[index].key & shard->bucket_mask];
+  while (*link != index) {
+    link = &shard->entries[*link].chain;
+  }
+  *link = shard->entries[index].chain;
+}
+
+static void insert_entry(move_cache_shard_t *shard, uint64_t key, const move_list_t *move_list) {
+  uint32_t index = find_entry(shard, key);
+  if (index != NO_CACHE_ENTRY) {
+    unlink_entry(shard, index);
+  } else {
+    if (shard->count < shard->capacity) {
+      index = shard->count++;
+    } else {
+      index = shard->oldest;
+      unlink_entry(shard, index);
+      remove_from_chain(shard, index);
+    }
+    uint32_t *bucket = &shard->buckets[key & shard->bucket_mask];
+    shard->entries[index].key = key;
+    shard->entries[index].chain = *bucket;
+    *bucket = index;
+  }
+  move_cache_entry_t *entry = &shard->entries[index];
+  entry->count = (uint8_t) move_list->count;
+  memcpy(entry->moves, move_list->entries, sizeof(move_t) * move_list->count);
+  push_newest(shard, index);
+}
+
+void init_move_cache(move_cache_t *cache, size_t capacity) {
+  size_t shard_capacity = (capacity + MOVE_CACHE_SHARDS - 1) / MOVE_CACHE_SHARDS;
+  uint32_t bucket_count = 1;
+
+  if (shard_capacity == 0) {
+    shard_capacity = 1;
+  }
+  while (bucket_count < shard_capacity) {
+    bucket_count *= 2;
+  }
+  for (int i = 0; i < MOVE_CACHE_SHARDS; i++) {
+    move_cache_shard_t *shard = &cache->shards[i];
+    pthread_mutex_init(&shard->mutex, NULL);
+    shard->entries = (move_cache_entry_t*)malloc(sizeof(move_cache_entry_t) * shard_capacity);
+    shard->buckets = (uint32_t*)malloc(sizeof(uint32_t) * bucket_count);
+    memset(shard->buckets, 0xFF, sizeof(uint32_t) * bucket_count);
+    shard->bucket_mask = bucket_count - 1;
+    shard->capacity = (uint32_t) shard_capacity;
+    shard->count = 0;
+    shard->newest = NO_CACHE_ENTRY;
+    shard->oldest = NO_CACHE_ENTRY;
+    shard->hits = 0;
+    shard->misses = 0;
+  }
+}
+
+void free_move_cache(move_cache_t *cache) {
+  for (int i = 0; i < MOVE_CACHE_SHARDS; i++) {
+    move_cache_shard_t *shard = &cache->shards[i];
+    free(shard->entries);
+    free(shard->buckets);
+    shard->entries = NULL;
+    shard->buckets = NULL;
+    pthread_mutex_destroy(&shard->mutex);
+  }
+}
+
+void cached_legal_moves(move_cache_t *cache, game_t *game, move_list_t *move_list) {
+  move_cache_shard_t *shard = &cache->shards[SHARD_INDEX(game->key)];
+
+  pthread_mutex_lock(&shard->mutex);
+  uint32_t index = find_entry(shard, game->key);
+  if (index != NO_CACHE_ENTRY) {
+    move_cache_entry_t *entry = &shard->entries[index];
+    move_list->count = entry->count;
+    memcpy(move_list->entries, entry->moves, sizeof(move_t) * entry->count);
+    unlink_entry(shard, index);
+    push_newest(shard, index);
+    shard->hits++;
+    pthread_mutex_unlock(&shard->mutex);
+    return;
+  }
+  shard->misses++;
+  pthread_mutex_unlock(&shard->mutex);
+
+  init_move_list(move_list);
+  calculate_legal_moves(game, move_list);
+
+  pthread_mutex_lock(&shard->mutex);
+  insert_entry(shard, game->key, move_list);
+  pthread_mutex_unlock(&shard->mutex);
+}
+
+void move_cache_stats(move_cache_t *cache, unsigned long long *hits, unsigned long long *misses) {
+  *hits = 0;
+  *misses = 0;
+  for (int i = 0; i < MOVE_CACHE_SHARDS; i++) {
+    move_cache_shard_t *shard = &cache->shards[i];
+    pthread_mutex_lock(&shard->mutex);
+    *hits += shard->hits;
+    *misses += shard->misses;
+    pthread_mutex_unlock(&shard->mutex);
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef MOVECACHE_H
+#define MOVECACHE_H
+
+#include <pthread.h>
+
+#include "game.h"
+
+#define MOVE_CACHE_SHARDS 64
+#define NO_CACHE_ENTRY UINT32_MAX
+
+typedef struct move_cache_entry {
+  uint64_t key;
+  uint32_t chain;
+  uint32_t newer;
+  uint32_t older;
+  uint8_t count;
+  move_t moves[MAX_MOVES];
+} move_cache_entry_t;
+
+typedef struct move_cache_shard {
+  pthread_mutex_t mutex;
+  move_cache_entry_t *entries;
+  uint32_t *buckets;
+  uint32_t bucket_mask;
+  uint32_t capacity;
+  uint32_t count;
+  uint32_t newest;
+  uint32_t oldest;
+  unsigned long long hits;
+  unsigned long long misses;
+} move_cache_shard_t;
+
+typedef struct move_cache {
+  move_cache_shard_t shards[MOVE_CACHE_SHARDS];
+} move_cache_t;
+
+void init_move_cache(move_cache_t *cache, size_t capacity);
+void free_move_cache(move_cache_t *cache);
+void cached_legal_moves(move_cache_t *cache, game_t *game, move_list_t *move_list);
+void move_cache_stats(move_cache_t *cache, unsigned long long *hits, unsigned long long *misses);
+
+#endif
@@ -0,0 +1,195 @@
+#include "movepick.h"
+#include "see.h"
+#include "stats.h"
+
+#define PROMOTION_BONUS 8
+
+static int capture_score(game_t *game, move_t move) {
+  board_t *board = &game->position;
+  piece_type_t attacker = piece_type_at(board, game->color_to_move, MOVE_START(move));
+  piece_type_t victim = (MOVE_FLAGS(move) == MOVE_ENPASSANT || !is_capture_move(game, move)) ? PAWN : piece_type_at(board, !game->color_to_move, MOVE_END(move));
+  int score = victim * 8 - attacker;
+  if (MOVE_PROMOTED_PIECE_TYPE(move) == QUEEN) {
+    score += PROMOTION_BONUS;
+  }
+  return score;
+}
+
+static void score_captures(move_picker_t *picker) {
+  for (int i = 0; i < picker->move_list.count; i++) {
+    picker->scores[i] = capture_score(picker->game, picker->move_list.entries[i]);
+  }
+}
+
+static void score_quiets(move_picker_t *picker) {
+  for (int i = 0; i < picker->move_list.count; i++) {
+    move_t move = picker->move_list.entries[i];
+    picker->scores[i] = picker->history[MOVE_START(move)][MOVE_END(move)];
+  }
+}
+
+static void score_evasions(move_picker_t *picker) {
+  for (int i = 0; i < picker->move_list.count; i++) {
+    move_t move = picker->move_list.entries[i];
+    if (is_capture_move(picker->game, move) || MOVE_PROMOTED_PIECE_TYPE(move) == QUEEN) {
+      picker->scores[i] = (1 << 28) + capture_score(picker->game, move);
+    } else {
+      picker->scores[i] = picker->history[MOVE_START(move)][MOVE_END(move)];
+    }
+  }
+}
+
+static move_t pick_best(move_picker_t *picker) {
+  move_list_t *move_list = &picker->move_list;
+  int *scores = picker->scores;
+  int index = picker->index;
+  int best = index;
+  for (int i = index + 1; i < move_list->count; i++) {
+    if (scores[i] > scores[best]) {
+      best = i;
+    }
+  }
+  move_t move = move_list->entries[best];
+  int score = scores[best];
+  move_list->entries[best] = move_list->entries[index];
+  scores[best] = scores[index];
+  move_list->entries[index] = move;
+  scores[index] = score;
+  picker->index++;
+  return move;
+}
+
+static bool is_noisy(game_t *game, move_t move) {
+  return is_capture_move(game, move) || MOVE_PROMOTED_PIECE_TYPE(move) == QUEEN;
+}
+
+void init_move_picker(move_picker_t *picker, game_t *game, move_t tt_move, const move_t *killers, int (*history)[64], bool in_check) {
+  picker->game = game;
+  picker->stage = in_check ? STAGE_EVASION_TT : STAGE_TT;
+  picker->tt_move = is_legal_move(game, tt_move) ? tt_move : NO_MOVE;
+  picker->killers[0] = killers[0];
+  picker->killers[1] = killers[1];
+  picker->killer_index = 0;
+  picker->history = history;
+  picker->index = 0;
+  picker->bad_capture_index = 0;
+  init_move_list(&picker->move_list);
+  init_move_list(&picker->bad_captures);
+}
+
+void init_quiescence_picker(move_picker_t *picker, game_t *game, move_t tt_move, int (*history)[64], bool in_check) {
+  picker->game = game;
+  picker->stage = in_check ? STAGE_EVASION_TT : STAGE_QS_TT;
+  picker->tt_move = (is_legal_move(game, tt_move) && (in_check || is_noisy(game, tt_move))) ? tt_move : NO_MOVE;
+  picker->killers[0] = NO_MOVE;
+  picker->killers[1] = NO_MOVE;
+  picker->killer_index = 0;
+  picker->history = history;
+  picker->index = 0;
+  picker->bad_capture_index = 0;
+  init_move_list(&picker->move_list);
+  init_move_list(&picker->bad_captures);
+}
+
+move_t next_move(move_picker_t *picker) {
+  game_t *game = picker->game;
+  move_t move;
+
+  switch (picker->stage) {
+    case STAGE_TT:
+    case STAGE_EVASION_TT:
+    case STAGE_QS_TT:
+      picker->stage++;
+      if (picker->tt_move != NO_MOVE) {
+        return picker->tt_move;
+      }
+      return next_move(picker);
+
+    case STAGE_INIT_CAPTURES:
+    case STAGE_QS_INIT_CAPTURES: {
+      STATS_TIMER_START(start);
+      calculate_captures(game, &picker->move_list);
+      STATS_TIMER_STOP(generation_ticks, start);
+      STATS_ADD(moves_generated, picker->move_list.count);
+      score_captures(picker);
+      picker->stage++;
+      return next_move(picker);
+    }
+
+    case STAGE_GOOD_CAPTURES:
+      while (picker->index < picker->move_list.count) {
+        move = pick_best(picker);
+        if (move == picker->tt_move) {
+          continue;
+        }
+        if (!see_ge(game, move, 0)) {
+          add_to_move_list(&picker->bad_captures, move);
+          continue;
+        }
+        return move;
+      }
+      picker->stage = STAGE_KILLERS;
+      return next_move(picker);
+
+    case STAGE_QS_CAPTURES:
+    case STAGE_EVASIONS:
+      while (picker->index < picker->move_list.count) {
+        move = pick_best(picker);
+        if (move != picker->tt_move) {
+          return move;
+        }
+      }
+      picker->stage = STAGE_DONE;
+      return NO_MOVE;
+
+    case STAGE_KILLERS:
+      while (picker->killer_index < 2) {
+        move = picker->killers[picker->killer_index++];
+        if (move != NO_MOVE && move != picker->tt_move && !is_noisy(game, move) && is_legal_move(game, move)) {
+          return move;
+        }
+      }
+      picker->stage = STAGE_INIT_QUIETS;
+      return next_move(picker);
+
+    case STAGE_INIT_QUIETS: {
+      init_move_list(&picker->move_list);
+      STATS_TIMER_START(start);
+      calculate_quiet_moves(game, &picker->move_list);
+      STATS_TIMER_STOP(generation_ticks, start);
+      STATS_ADD(moves_generated, picker->move_list.count);
+      score_quiets(picker);
+      picker->index = 0;
+      picker->stage = STAGE_QUIETS;
+      return next_move(picker);
+    }
+
+    case STAGE_QUIETS:
+      while (picker->index < picker->move_list.count) {
+        move = pick_best(picker);
+        if (move != picker->tt_move && move != picker->killers[0] && move != picker->killers[1]) {
+          return move;
+        }
+      }
+      picker->stage = STAGE_BAD_CAPTURES;
+      return next_move(picker);
+
+    case STAGE_BAD_CAPTURES:
+      if (picker->bad_capture_index < picker->bad_captures.count) {
+        return picker->bad_captures.entries[picker->bad_capture_index++];
+      }
+      picker->stage = STAGE_DONE;
+      return NO_MOVE;
+
+    case STAGE_INIT_EVASIONS: {
+      STATS_TIMER_START(start);
+      calculate_legal_moves(game, &picker->move_list);
+      STATS_TIMER_STOP(generation_ticks, start);
+      STATS_ADD(moves_generated, picker->move_list.count);
+      score_evasions(picker);
+      picker->stage = STAGE_EVASIONS;
+      return next_move(picker);
+    }
+  }
+  return NO_MOVE;
+}
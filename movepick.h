@@ -0,0 +1,39 @@
+#ifndef MOVEPICK_H
+#define MOVEPICK_H
+
+#include "game.h"
+
+#define STAGE_TT 0
+#define STAGE_INIT_CAPTURES 1
+#define STAGE_GOOD_CAPTURES 2
+#define STAGE_KILLERS 3
+#define STAGE_INIT_QUIETS 4
+#define STAGE_QUIETS 5
+#define STAGE_BAD_CAPTURES 6
+#define STAGE_EVASION_TT 7
+#define STAGE_INIT_EVASIONS 8
+#define STAGE_EVASIONS 9
+#define STAGE_QS_TT 10
+#define STAGE_QS_INIT_CAPTURES 11
+#define STAGE_QS_CAPTURES 12
+#define STAGE_DONE 13
+
+typedef struct move_picker {
+  game_t *game;
+  int stage;
+  move_t tt_move;
+  move_t killers[2];
+  int killer_index;
+  int (*history)[64];
+  move_list_t move_list;
+  move_list_t bad_captures;
+  int bad_capture_index;
+  int scores[MAX_MOVES];
+  int index;
+} move_picker_t;
+
+void init_move_picker(move_picker_t *picker, game_t *game, move_t tt_move, const move_t *killers, int (*history)[64], bool in_check);
+void init_quiescence_picker(move_picker_t *picker, game_t *game, move_t tt_move, int (*history)[64], bool in_check);
+move_t next_move(move_picker_t *picker);
+
+#endif
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "nnue.h"
+#include "search.h"
+
+#define NNUE_MAX_SCORE (TB_BOUND - 1)
+
+typedef struct nnue_network {
+  bool loaded;
+  int16_t *feature_biases;
+  int16_t *feature_weights;
+  int16_t *output_weights;
+  int32_t output_bias;
+} nnue_network_t;
+
+static nnue_network_t network = { false, NULL, NULL, NULL, 0 };
+
+static void *alloc_weights(size_t count) {
+  size_t size = (count * sizeof(int16_t) + 63) & ~(size_t) 63;
+  return aligned_alloc(64, size);
+}
+
+static bool read_values(FILE *file, void *values, size_t size, size_t count) {
+  return fread(values, size, count, file) == count;
+}
+
+bool nnue_load(const char *path) {
+  FILE *file = fopen(path, "rb");
+  uint32_t header[3];
+
+  if (file == NULL) {
+    return false;
+  }
+  int16_t *feature_biases = (int16_t*)alloc_weights(NNUE_HIDDEN);
+  int16_t *feature_weights = (int16_t*)alloc_weights((size_t) NNUE_FEATURES * NNUE_HIDDEN);
+  int16_t *output_weights = (int16_t*)alloc_weights(2 * NNUE_HIDDEN);
+  int32_t output_bias;
+  bool ok = read_values(file, header, sizeof(uint32_t), 3) &&
+            header[0] == NNUE_MAGIC && header[1] == NNUE_VERSION && header[2] == NNUE_HIDDEN &&
+            read_values(file, feature_biases, sizeof(int16_t), NNUE_HIDDEN) &&
+            read_values(file, feature_weights, sizeof(int16_t), (size_t) NNUE_FEATURES * NNUE_HIDDEN) &&
+            read_values(file, output_weights, sizeof(int16_t), 2 * NNUE_HIDDEN) &&
+            read_values(file, &output_bias, sizeof(int32_t), 1);
+  fclose(file);
+
+  if (!ok) {
+    free(feature_biases);
+    free(feature_weights);
+    free(output_weights);
+    return false;
+  }
+  free(network.feature_biases);
+  free(network.feature_weights);
+  free(network.output_weights);
+  network.feature_biases = feature_biases;
+  network.feature_weights = feature_weights;
+  network.output_weights = output_weights;
+  network.output_bias = output_bias;
+  network.loaded = true;
+  return true;
+}
+
+bool nnue_is_loaded(void) {
+  return network.loaded;
+}
+
+void nnue_attach(game_t *game) {
+  if (game->nnue == NULL) {
+    game->nnue = (nnue_stack_t*)malloc(sizeof(nnue_stack_t));
+    game->nnue->capacity = DEFAULT_NNUE_STACK_CAPACITY;
+    game->nnue->entries = (nnue_accumulator_t*)malloc(sizeof(nnue_accumulator_t) * DEFAULT_NNUE_STACK_CAPACITY);
+  }
+  nnue_reset(game->nnue);
+}
+
+static int feature_index(color_t perspective, int king_square, color_t color, piece_type_t piece_type, int square) {
+  if (perspective == BLACK) {
+    king_square ^= 56;
+    square ^= 56;
+  }
+  return (king_square * 10 + piece_type * 2 + (color != perspective)) * 64 + square;
+}
+
+static void add_column(int16_t *values, const int16_t *column) {
+#if defined(__AVX2__)
+  for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+    __m256i sum = _mm256_add_epi16(_mm256_loadu_si256((const __m256i*) &values[i]), _mm256_load_si256((const __m256i*) &column[i]));
+    _mm256_storeu_si256((__m256i*) &values[i], sum);
+  }
+#elif defined(__SSE2__)
+  for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+    __m128i sum = _mm_add_epi16(_mm_loadu_si128((const __m128i*) &values[i]), _mm_load_si128((const __m128i*) &column[i]));
+    _mm_storeu_si128((__m128i*) &values[i], sum);
+  }
+#else
+  for (int i = 0; i < NNUE_HIDDEN; i++) {
+    values[i] += column[i];
+  }
+#endif
+}
+
+static void sub_column(int16_t *values, const int16_t *column) {
+#if defined(__AVX2__)
+  for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+    __m256i difference = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*) &values[i]), _mm256_load_si256((const __m256i*) &column[i]));
+    _mm256_storeu_si256((__m256i*) &values[i], difference);
+  }
+#elif defined(__SSE2__)
+  for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+    __m128i difference = _mm_sub_epi16(_mm_loadu_si128((const __m128i*) &values[i]), _mm_load_si128((const __m128i*) &column[i]));
+    _mm_storeu_si128((__m128i*) &values[i], difference);
+  }
+#else
+  for (int i = 0; i < NNUE_HIDDEN; i++) {
+    values[i] -= column[i];
+  }
+#endif
+}
+
+static const int16_t *feature_column(int index) {
+  return &network.feature_weights[(size_t) index * NNUE_HIDDEN];
+}
+
+static void refresh_accumulator(board_t *board, nnue_accumulator_t *accumulator, color_t perspective) {
+  int16_t *values = accumulator->values[perspective];
+  int king_square = lsb(board->pieces[perspective][KING]);
+
+  memcpy(values, network.feature_biases, sizeof(int16_t) * NNUE_HIDDEN);
+  for (int color = WHITE; color <= BLACK; color++) {
+    for (int piece_type = PAWN; piece_type < KING; piece_type++) {
+      bitboard_t bb = board->pieces[color][piece_type];
+      while (bb) {
+        add_column(values, feature_column(feature_index(perspective, king_square, (color_t) color, (piece_type_t) piece_type, pop_lsb(&bb))));
+      }
+    }
+  }
+  accumulator->computed[perspective] = true;
+}
+
+static void apply_dirty_pieces(nnue_accumulator_t *previous, nnue_accumulator_t *accumulator, color_t perspective, int king_square) {
+  int16_t *values = accumulator->values[perspective];
+  dirty_piece_t *dirty = &accumulator->dirty;
+
+  memcpy(values, previous->values[perspective], sizeof(int16_t) * NNUE_HIDDEN);
+  for (int i = 0; i < dirty->count; i++) {
+    if (dirty->piece_type[i] == KING) {
+      continue;
+    }
+    if (dirty->from[i] != NO_SQUARE) {
+      sub_column(values, feature_column(feature_index(perspective, king_square, (color_t) dirty->color[i], (piece_type_t) dirty->piece_type[i], dirty->from[i])));
+    }
+    if (dirty->to[i] != NO_SQUARE) {
+      add_column(values, feature_column(feature_index(perspective, king_square, (color_t) dirty->color[i], (piece_type_t) dirty->piece_type[i], dirty->to[i])));
+    }
+  }
+  accumulator->computed[perspective] = true;
+}
+
+static bool moves_king(dirty_piece_t *dirty, color_t color) {
+  for (int i = 0; i < dirty->count; i++) {
+    if (dirty->piece_type[i] == KING && dirty->color[i] == (int8_t) color) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void update_accumulator(game_t *game, color_t perspective) {
+  nnue_stack_t *stack = game->nnue;
+  int top = stack->count - 1;
+  int index = top;
+
+  while (!stack->entries[index].computed[perspective]) {
+    if (index == 0 || moves_king(&stack->entries[index].dirty, perspective)) {
+      refresh_accumulator(&game->position, &stack->entries[top], perspective);
+      return;
+    }
+    index--;
+  }
+  int king_square = lsb(game->position.pieces[perspective][KING]);
+  for (index++; index <= top; index++) {
+    apply_dirty_pieces(&stack->entries[index - 1], &stack->entries[index], perspective, king_square);
+  }
+}
+
+static int32_t output_layer(const int16_t *values, const int16_t *weights) {
+#if defined(__AVX2__)
+  __m256i zero = _mm256_setzero_si256();
+  __m256i clip = _mm256_set1_epi16(NNUE_CLIP);
+  __m256i sum = _mm256_setzero_si256();
+  for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+    __m256i clipped = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i*) &values[i]), zero), clip);
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(clipped, _mm256_load_si256((const __m256i*) &weights[i])));
+  }
+  __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+  half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+  return _mm_cvtsi128_si32(half);
+#elif defined(__SSE2__)
+  __m128i zero = _mm_setzero_si128();
+  __m128i clip = _mm_set1_epi16(NNUE_CLIP);
+  __m128i sum = _mm_setzero_si128();
+  for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+    __m128i clipped = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i*) &values[i]), zero), clip);
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(clipped, _mm_load_si128((const __m128i*) &weights[i])));
+  }
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+  return _mm_cvtsi128_si32(sum);
+#else
+  int32_t sum = 0;
+  for (int i = 0; i < NNUE_HIDDEN; i++) {
+    int value = values[i] < 0 ? 0 : values[i] > NNUE_CLIP ? NNUE_CLIP : values[i];
+    sum += value * weights[i];
+  }
+  return sum;
+#endif
+}
+
+int nnue_evaluate(game_t *game) {
+  color_t us = game->color_to_move;
+  color_t them = (color_t) !us;
+
+  update_accumulator(game, WHITE);
+  update_accumulator(game, BLACK);
+  nnue_accumulator_t *accumulator = &game->nnue->entries[game->nnue->count - 1];
+  int32_t sum = network.output_bias +
+                output_layer(accumulator->values[us], network.output_weights) +
+                output_layer(accumulator->values[them], network.output_weights + NNUE_HIDDEN);
+  int score = sum / NNUE_OUTPUT_SCALE;
+  return (score > NNUE_MAX_SCORE) ? NNUE_MAX_SCORE : (score < -NNUE_MAX_SCORE) ? -NNUE_MAX_SCORE : score;
+}
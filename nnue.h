@@ -0,0 +1,92 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "game.h"
+
+/*
+ * Network file layout, little-endian:
+ *   uint32 magic (NNUE_MAGIC), uint32 version (NNUE_VERSION), uint32 hidden size (NNUE_HIDDEN)
+ *   int16  feature_biases[NNUE_HIDDEN]
+ *   int16  feature_weights[NNUE_FEATURES][NNUE_HIDDEN]
+ *   int16  output_weights[2 * NNUE_HIDDEN]   side to move half first
+ *   int32  output_bias
+ * Features are HalfKP: (own king square, piece color relative to the
+ * perspective, piece type without kings, square), with black's view
+ * mirrored vertically.
+ */
+#define NNUE_MAGIC 0x45554E4E
+#define NNUE_VERSION 1
+#define NNUE_HIDDEN 256
+#define NNUE_FEATURES (64 * 10 * 64)
+#define NNUE_CLIP 127
+#define NNUE_OUTPUT_SCALE (NNUE_CLIP * 64)
+#define DEFAULT_NNUE_STACK_CAPACITY 128
+#define MAX_DIRTY_PIECES 3
+
+typedef struct dirty_piece {
+  int count;
+  int8_t color[MAX_DIRTY_PIECES];
+  int8_t piece_type[MAX_DIRTY_PIECES];
+  int8_t from[MAX_DIRTY_PIECES];
+  int8_t to[MAX_DIRTY_PIECES];
+} dirty_piece_t;
+
+typedef struct nnue_accumulator {
+  int16_t values[2][NNUE_HIDDEN];
+  bool computed[2];
+  dirty_piece_t dirty;
+} nnue_accumulator_t;
+
+struct nnue_stack {
+  int count;
+  int capacity;
+  nnue_accumulator_t *entries;
+};
+
+bool nnue_load(const char *path);
+bool nnue_is_loaded(void);
+void nnue_attach(game_t *game);
+int nnue_evaluate(game_t *game);
+
+static inline dirty_piece_t *nnue_push(nnue_stack_t *stack) {
+  if (stack->count == stack->capacity) {
+    stack->capacity *= 2;
+    stack->entries = (nnue_accumulator_t*)realloc(stack->entries, sizeof(nnue_accumulator_t) * stack->capacity);
+  }
+  nnue_accumulator_t *accumulator = &stack->entries[stack->count++];
+  accumulator->computed[WHITE] = false;
+  accumulator->computed[BLACK] = false;
+  accumulator->dirty.count = 0;
+  return &accumulator->dirty;
+}
+
+static inline void nnue_pop(nnue_stack_t *stack) {
+  stack->count--;
+}
+
+static inline void nnue_reset(nnue_stack_t *stack) {
+  stack->count = 0;
+  nnue_push(stack);
+}
+
+static inline void nnue_detach(game_t *game) {
+  if (game->nnue) {
+    free(game->nnue->entries);
+    free(game->nnue);
+    game->nnue = NULL;
+  }
+}
+
+static inline void add_dirty_piece(dirty_piece_t *dirty, color_t color, piece_type_t piece_type, int from, int to) {
+  dirty->color[dirty->count] = (int8_t) color;
+  dirty->piece_type[dirty->count] = (int8_t) piece_type;
+  dirty->from[dirty->count] = (int8_t) from;
+  dirty->to[dirty->count] = (int8_t) to;
+  dirty->count++;
+}
+
+#endif
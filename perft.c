@@ -0,0 +1,501 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "game.h"
+
+#define STARTING_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+#define MAX_SUITE_DEPTH 7
+#define DEFAULT_SPLIT_DEPTH 2
+#define MAX_LINE_LENGTH 1024
+
+typedef struct perft_case {
+  const char *fen;
+  unsigned long long nodes[MAX_SUITE_DEPTH];
+} perft_case_t;
+
+typedef struct perft_hash_entry {
+  _Atomic uint64_t checksum;
+  _Atomic uint64_t data;
+} perft_hash_entry_t;
+
+typedef struct perft_hash {
+  perft_hash_entry_t *entries;
+  uint64_t mask;
+} perft_hash_t;
+
+typedef struct perft_task {
+  board_t position;
+  uint64_t key;
+  color_t color_to_move;
+  int castling_rights;
+  int en_passant_square;
+  int depth;
+  _Atomic unsigned long long *nodes;
+} perft_task_t;
+
+typedef struct task_list {
+  int count;
+  int capacity;
+  perft_task_t *entries;
+} task_list_t;
+
+typedef struct task_deque {
+  pthread_mutex_t lock;
+  perft_task_t *tasks;
+  int head;
+  int tail;
+  int capacity;
+} task_deque_t;
+
+typedef struct perft_pool perft_pool_t;
+
+typedef struct perft_worker {
+  perft_pool_t *pool;
+  int index;
+  pthread_t thread;
+  game_t game;
+} perft_worker_t;
+
+struct perft_pool {
+  int thread_count;
+  perft_worker_t *workers;
+  task_deque_t *deques;
+  perft_hash_t *hash;
+  pthread_mutex_t lock;
+  pthread_cond_t work_ready;
+  pthread_cond_t work_done;
+  int batch;
+  atomic_int pending;
+  bool shutdown;
+};
+
+static const perft_case_t perft_suite[] = {
+  { STARTING_FEN, { 20, 400, 8902, 197281, 4865609, 119060324 } },
+  { "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", { 48, 2039, 97862, 4085603, 193690690 } },
+  { "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", { 14, 191, 2812, 43238, 674624, 11030083, 178633661 } },
+  { "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", { 6, 264, 9467, 422333, 15833292 } },
+  { "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", { 6, 264, 9467, 422333, 15833292 } },
+  { "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", { 44, 1486, 62379, 2103487, 89941194 } },
+  { "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", { 46, 2079, 89890, 3894594, 164075551 } }
+};
+
+static double elapsed_seconds(struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static perft_hash_t *create_perft_hash(size_t megabytes) {
+  perft_hash_t *hash = (perft_hash_t*)malloc(sizeof(perft_hash_t));
+  size_t entry_count = 1;
+  while (entry_count * 2 * sizeof(perft_hash_entry_t) <= megabytes * 1024 * 1024) {
+    entry_count *= 2;
+  }
+  hash->entries = (perft_hash_entry_t*)calloc(entry_count, sizeof(perft_hash_entry_t));
+  hash->mask = entry_count - 1;
+  return hash;
+}
+
+static void free_perft_hash(perft_hash_t *hash) {
+  free(hash->entries);
+  free(hash);
+}
+
+static bool probe_perft_hash(perft_hash_t *hash, uint64_t key, int depth, unsigned long long *nodes) {
+  perft_hash_entry_t *entry = &hash->entries[key & hash->mask];
+  uint64_t checksum = atomic_load_explicit(&entry->checksum, memory_order_relaxed);
+  uint64_t data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+  if ((checksum ^ data) == key && (int) (data & 0xFF) == depth) {
+    *nodes = data >> 8;
+    return true;
+  }
+  return false;
+}
+
+static void store_perft_hash(perft_hash_t *hash, uint64_t key, int depth, unsigned long long nodes) {
+  perft_hash_entry_t *entry = &hash->entries[key & hash->mask];
+  uint64_t data = (nodes << 8) | (uint64_t) depth;
+  atomic_store_explicit(&entry->checksum, key ^ data, memory_order_relaxed);
+  atomic_store_explicit(&entry->data, data, memory_order_relaxed);
+}
+
+static unsigned long long perft(game_t *game, int depth, perft_hash_t *hash) {
+  move_list_t move_list;
+  unsigned long long nodes = 0;
+
+  if (depth == 0) {
+    return 1;
+  }
+  if (hash && depth > 1 && probe_perft_hash(hash, game->key, depth, &nodes)) {
+    return nodes;
+  }
+  init_move_list(&move_list);
+  calculate_legal_moves(game, &move_list);
+  if (depth == 1) {
+    return move_list.count;
+  }
+  for (int i = 0; i < move_list.count; i++) {
+    make_move(game, move_list.entries[i]);
+    nodes += perft(game, depth - 1, hash);
+    unmake_move(game);
+  }
+  if (hash) {
+    store_perft_hash(hash, game->key, depth, nodes);
+  }
+  return nodes;
+}
+
+static void add_task(task_list_t *task_list, game_t *game, int depth, _Atomic unsigned long long *nodes) {
+  if (task_list->count == task_list->capacity) {
+    task_list->capacity = task_list->capacity ? task_list->capacity * 2 : 256;
+    task_list->entries = (perft_task_t*)realloc(task_list->entries, sizeof(perft_task_t) * task_list->capacity);
+  }
+  perft_task_t *task = &task_list->entries[task_list->count++];
+  task->position = game->position;
+  task->key = game->key;
+  task->color_to_move = game->color_to_move;
+  task->castling_rights = game->castling_rights;
+  task->en_passant_square = game->en_passant_square;
+  task->depth = depth;
+  task->nodes = nodes;
+}
+
+static void load_task(game_t *game, perft_task_t *task) {
+  game->position = task->position;
+  game->key = task->key;
+  game->color_to_move = task->color_to_move;
+  game->castling_rights = task->castling_rights;
+  game->en_passant_square = task->en_passant_square;
+  game->halfmove_clock = 0;
+  game->undo_stack.count = 0;
+}
+
+static void split_tree(game_t *game, int depth, int split_depth, _Atomic unsigned long long *nodes, task_list_t *task_list) {
+  move_list_t move_list;
+
+  if (split_depth <= 0 || depth <= 1) {
+    add_task(task_list, game, depth, nodes);
+    return;
+  }
+  init_move_list(&move_list);
+  calculate_legal_moves(game, &move_list);
+  for (int i = 0; i < move_list.count; i++) {
+    make_move(game, move_list.entries[i]);
+    split_tree(game, depth - 1, split_depth - 1, nodes, task_list);
+    unmake_move(game);
+  }
+}
+
+static bool pop_task(task_deque_t *deque, perft_task_t *task, bool steal) {
+  bool found = false;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->head < deque->tail) {
+    *task = steal ? deque->tasks[deque->head++] : deque->tasks[--deque->tail];
+    found = true;
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return found;
+}
+
+static bool next_task(perft_worker_t *worker, perft_task_t *task) {
+  perft_pool_t *pool = worker->pool;
+  if (pop_task(&pool->deques[worker->index], task, false)) {
+    return true;
+  }
+  for (int i = 1; i < pool->thread_count; i++) {
+    if (pop_task(&pool->deques[(worker->index + i) % pool->thread_count], task, true)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void *perft_worker_main(void *arg) {
+  perft_worker_t *worker = (perft_worker_t*)arg;
+  perft_pool_t *pool = worker->pool;
+  perft_task_t task;
+  int batch = 0;
+
+  while (true) {
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->shutdown && pool->batch == batch) {
+      pthread_cond_wait(&pool->work_ready, &pool->lock);
+    }
+    if (pool->shutdown) {
+      pthread_mutex_unlock(&pool->lock);
+      return NULL;
+    }
+    batch = pool->batch;
+    pthread_mutex_unlock(&pool->lock);
+
+    while (next_task(worker, &task)) {
+      load_task(&worker->game, &task);
+      atomic_fetch_add(task.nodes, perft(&worker->game, task.depth, pool->hash));
+      if (atomic_fetch_sub(&pool->pending, 1) == 1) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->work_done);
+        pthread_mutex_unlock(&pool->lock);
+      }
+    }
+  }
+}
+
+static perft_pool_t *create_perft_pool(int thread_count, perft_hash_t *hash) {
+  perft_pool_t *pool = (perft_pool_t*)calloc(1, sizeof(perft_pool_t));
+  pool->thread_count = thread_count;
+  pool->hash = hash;
+  pool->workers = (perft_worker_t*)calloc(thread_count, sizeof(perft_worker_t));
+  pool->deques = (task_deque_t*)calloc(thread_count, sizeof(task_deque_t));
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work_ready, NULL);
+  pthread_cond_init(&pool->work_done, NULL);
+  atomic_init(&pool->pending, 0);
+  for (int i = 0; i < thread_count; i++) {
+    pthread_mutex_init(&pool->deques[i].lock, NULL);
+    pool->workers[i].pool = pool;
+    pool->workers[i].index = i;
+    init_game(&pool->workers[i].game);
+    pthread_create(&pool->workers[i].thread, NULL, perft_worker_main, &pool->workers[i]);
+  }
+  return pool;
+}
+
+static void destroy_perft_pool(perft_pool_t *pool) {
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = true;
+  pthread_cond_broadcast(&pool->work_ready);
+  pthread_mutex_unlock(&pool->lock);
+  for (int i = 0; i < pool->thread_count; i++) {
+    pthread_join(pool->workers[i].thread, NULL);
+    free_game(&pool->workers[i].game);
+    pthread_mutex_destroy(&pool->deques[i].lock);
+    free(pool->deques[i].tasks);
+  }
+  pthread_cond_destroy(&pool->work_done);
+  pthread_cond_destroy(&pool->work_ready);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->workers);
+  free(pool->deques);
+  free(pool);
+}
+
+static void run_tasks(perft_pool_t *pool, task_list_t *task_list) {
+  int share = task_list->count / pool->thread_count + 1;
+
+  if (task_list->count == 0) {
+    return;
+  }
+  for (int i = 0; i < pool->thread_count; i++) {
+    task_deque_t *deque = &pool->deques[i];
+    pthread_mutex_lock(&deque->lock);
+    if (deque->capacity < share) {
+      deque->capacity = share;
+      deque->tasks = (perft_task_t*)realloc(deque->tasks, sizeof(perft_task_t) * share);
+    }
+    deque->head = 0;
+    deque->tail = 0;
+    for (int j = i; j < task_list->count; j += pool->thread_count) {
+      deque->tasks[deque->tail++] = task_list->entries[j];
+    }
+    pthread_mutex_unlock(&deque->lock);
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  atomic_store(&pool->pending, task_list->count);
+  pool->batch++;
+  pthread_cond_broadcast(&pool->work_ready);
+  while (atomic_load(&pool->pending) > 0) {
+    pthread_cond_wait(&pool->work_done, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+static unsigned long long run_perft(game_t *game, int depth, bool show_divide, perft_pool_t *pool, perft_hash_t *hash, int split_depth) {
+  move_list_t move_list;
+  _Atomic unsigned long long move_nodes[MAX_MOVES];
+  unsigned long long nodes = 0;
+  struct timespec start;
+  double seconds;
+  char move_str[6];
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (depth <= 0) {
+    nodes = 1;
+  } else if (!show_divide && !pool) {
+    nodes = perft(game, depth, hash);
+  } else {
+    task_list_t task_list = { 0, 0, NULL };
+    init_move_list(&move_list);
+    calculate_legal_moves(game, &move_list);
+    for (int i = 0; i < move_list.count; i++) {
+      atomic_init(&move_nodes[i], 0);
+      make_move(game, move_list.entries[i]);
+      if (pool) {
+        split_tree(game, depth - 1, split_depth - 1, &move_nodes[i], &task_list);
+      } else {
+        atomic_store(&move_nodes[i], perft(game, depth - 1, hash));
+      }
+      unmake_move(game);
+    }
+    if (pool) {
+      run_tasks(pool, &task_list);
+      free(task_list.entries);
+    }
+    for (int i = 0; i < move_list.count; i++) {
+      if (show_divide) {
+        move_to_string(move_list.entries[i], move_str);
+        printf("%s: %llu\n", move_str, atomic_load(&move_nodes[i]));
+      }
+      nodes += atomic_load(&move_nodes[i]);
+    }
+  }
+  seconds = elapsed_seconds(&start);
+  printf("depth %d nodes %llu time %.3fs nps %.0f\n", depth, nodes, seconds, (seconds > 0) ? nodes / seconds : 0.0);
+  return nodes;
+}
+
+static int run_suite(int max_depth, perft_pool_t *pool, perft_hash_t *hash, int split_depth) {
+  int failures = 0;
+  for (size_t i = 0; i < sizeof(perft_suite) / sizeof(perft_suite[0]); i++) {
+    const perft_case_t *test = &perft_suite[i];
+    game_t game;
+    int depth = 0;
+    while (depth < MAX_SUITE_DEPTH && test->nodes[depth] != 0 && (max_depth <= 0 || depth < max_depth)) {
+      depth++;
+    }
+    init_game(&game);
+    load_fen(&game, test->fen);
+    printf("%s\n", test->fen);
+    unsigned long long nodes = run_perft(&game, depth, false, pool, hash, split_depth);
+    if (nodes != test->nodes[depth - 1]) {
+      printf("FAILED: expected %llu\n", test->nodes[depth - 1]);
+      failures++;
+    }
+    free_game(&game);
+  }
+  printf("%d failure(s)\n", failures);
+  return failures != 0;
+}
+
+static int run_file(const char *path, int depth, perft_pool_t *pool, perft_hash_t *hash, int split_depth) {
+  FILE *file = fopen(path, "r");
+  char line[MAX_LINE_LENGTH];
+  int positions = 0;
+  int failures = 0;
+  game_t game;
+
+  if (file == NULL) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 2;
+  }
+  init_game(&game);
+  while (fgets(line, sizeof(line), file)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#') {
+      continue;
+    }
+    if (!load_fen(&game, line)) {
+      fprintf(stderr, "invalid fen: %s\n", line);
+      failures++;
+      continue;
+    }
+    printf("%s\n", line);
+    unsigned long long nodes = run_perft(&game, depth, false, pool, hash, split_depth);
+    positions++;
+    for (char *annotation = strchr(line, ';'); annotation; annotation = strchr(annotation + 1, ';')) {
+      int annotated_depth;
+      unsigned long long expected;
+      if (sscanf(annotation, ";D%d %llu", &annotated_depth, &expected) == 2 && annotated_depth == depth && nodes != expected) {
+        printf("FAILED: expected %llu\n", expected);
+        failures++;
+      }
+    }
+  }
+  fclose(file);
+  free_game(&game);
+  printf("%d position(s), %d failure(s)\n", positions, failures);
+  return failures != 0;
+}
+
+static void print_usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [--fen FEN] [--depth N] [--divide] [options]\n"
+          "       %s --suite [--depth MAX] [options]\n"
+          "       %s --file PATH [--depth N] [options]\n"
+          "options: --threads N --split PLIES --hash MB\n",
+          program, program, program);
+}
+
+int main(int argc, char **argv) {
+  const char *fen = STARTING_FEN;
+  const char *path = NULL;
+  int depth = 5;
+  bool depth_given = false;
+  bool show_divide = false;
+  bool suite = false;
+  int thread_count = 1;
+  int split_depth = DEFAULT_SPLIT_DEPTH;
+  int hash_mb = 0;
+  perft_pool_t *pool = NULL;
+  perft_hash_t *hash = NULL;
+  int status = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--fen") == 0 && i + 1 < argc) {
+      fen = argv[++i];
+    } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+      depth = atoi(argv[++i]);
+      depth_given = true;
+    } else if (strcmp(argv[i], "--divide") == 0) {
+      show_divide = true;
+    } else if (strcmp(argv[i], "--suite") == 0) {
+      suite = true;
+    } else if (strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+      path = argv[++i];
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      thread_count = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--split") == 0 && i + 1 < argc) {
+      split_depth = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc) {
+      hash_mb = atoi(argv[++i]);
+    } else {
+      print_usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (hash_mb > 0) {
+    hash = create_perft_hash(hash_mb);
+  }
+  if (thread_count > 1) {
+    pool = create_perft_pool(thread_count, hash);
+  }
+
+  if (suite) {
+    status = run_suite(depth_given ? depth : 0, pool, hash, split_depth);
+  } else if (path) {
+    status = run_file(path, depth, pool, hash, split_depth);
+  } else {
+    game_t game;
+    init_game(&game);
+    if (load_fen(&game, fen)) {
+      run_perft(&game, depth, show_divide, pool, hash, split_depth);
+    } else {
+      fprintf(stderr, "invalid fen: %s\n", fen);
+      status = 2;
+    }
+    free_game(&game);
+  }
+
+  if (pool) {
+    destroy_perft_pool(pool);
+  }
+  if (hash) {
+    free_perft_hash(hash);
+  }
+  return status;
+}
@@ -0,0 +1,426 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pgn.h"
+
+#define CHUNK_SIZE (4 * 1024 * 1024)
+#define STARTING_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+#define GAME_START "[Event "
+#define GAME_START_LENGTH 7
+
+typedef struct pgn_reader pgn_reader_t;
+
+typedef struct pgn_worker {
+  pgn_reader_t *reader;
+  int thread_index;
+  pthread_t thread;
+  game_t game;
+  pgn_stats_t stats;
+  char fen[MAX_FEN_LENGTH + 1];
+  int result;
+  bool in_game;
+  bool replaying;
+  bool failed;
+  bool in_comment;
+  int variation_depth;
+} pgn_worker_t;
+
+struct pgn_reader {
+  const char *data;
+  size_t size;
+  size_t chunk_count;
+  atomic_size_t next_chunk;
+  pgn_callback_t callback;
+  void *arg;
+};
+
+static const char *game_start_at_or_after(const char *data, size_t size, size_t offset) {
+  const char *end = data + size;
+
+  if (offset == 0) {
+    return data;
+  }
+  if (offset >= size) {
+    return end;
+  }
+  const char *cursor = data + offset - 1;
+  while ((cursor = memchr(cursor, '\n', end - cursor)) != NULL) {
+    cursor++;
+    if (end - cursor >= GAME_START_LENGTH && memcmp(cursor, GAME_START, GAME_START_LENGTH) == 0) {
+      return cursor;
+    }
+  }
+  return end;
+}
+
+static bool is_delimiter(char c) {
+  return c == ' ' || c == '\t' || c == '{' || c == '}' || c == '(' || c == ')' || c == ';';
+}
+
+static int parse_result(const char *token, size_t length) {
+  if (length == 3 && memcmp(token, "1-0", 3) == 0) {
+    return PGN_RESULT_WHITE_WIN;
+  } else if (length == 3 && memcmp(token, "0-1", 3) == 0) {
+    return PGN_RESULT_BLACK_WIN;
+  } else if (length == 7 && memcmp(token, "1/2-1/2", 7) == 0) {
+    return PGN_RESULT_DRAW;
+  }
+  return PGN_RESULT_UNKNOWN;
+}
+
+move_t parse_san(game_t *game, const char *san, size_t length) {
+  move_list_t move_list;
+  piece_type_t piece_type = PAWN;
+  piece_type_t promotion = PAWN;
+  char coords[4];
+  int coord_count = 0;
+  int castle = 0;
+  size_t i = 0;
+
+  if (length >= 3 && (memcmp(san, "O-O", 3) == 0 || memcmp(san, "0-0", 3) == 0)) {
+    castle = (length >= 5 && san[3] == '-' && (san[4] == 'O' || san[4] == '0')) ? MOVE_QUEEN_SIDE_CASTLE : MOVE_KING_SIDE_CASTLE;
+  } else {
+    const char *piece_chars = "NBRQK";
+    const char *piece_char = (length > 0) ? memchr(piece_chars, san[0], 5) : NULL;
+    if (piece_char) {
+      piece_type = (piece_type_t) (piece_char - piece_chars + KNIGHT);
+      i = 1;
+    }
+    for (; i < length; i++) {
+      char c = san[i];
+      if ((c >= 'a' && c <= 'h') || (c >= '1' && c <= '8')) {
+        if (coord_count == 4) {
+          return NO_MOVE;
+        }
+        coords[coord_count++] = c;
+      } else if (piece_type == PAWN && (piece_char = memchr(piece_chars, c, 4)) != NULL) {
+        promotion = (piece_type_t) (piece_char - piece_chars + KNIGHT);
+      } else if (c == '+' || c == '#' || c == '!' || c == '?') {
+        break;
+      }
+    }
+    if (coord_count < 2 || coords[coord_count - 2] < 'a' || coords[coord_count - 1] >= 'a') {
+      return NO_MOVE;
+    }
+  }
+
+  int end = castle ? NO_SQUARE : SQUARE(coords[coord_count - 1] - '1', 7 - (coords[coord_count - 2] - 'a'));
+  int from_col = -1;
+  int from_row = -1;
+  for (int j = 0; j < coord_count - 2; j++) {
+    if (coords[j] >= 'a') {
+      from_col = 7 - (coords[j] - 'a');
+    } else {
+      from_row = coords[j] - '1';
+    }
+  }
+
+  if (castle) {
+    init_move_list(&move_list);
+    calculate_legal_moves(game, &move_list);
+    for (int j = 0; j < move_list.count; j++) {
+      if (MOVE_FLAGS(move_list.entries[j]) == castle) {
+        return move_list.entries[j];
+      }
+    }
+    return NO_MOVE;
+  }
+
+  board_t *board = &game->position;
+  color_t color = game->color_to_move;
+  bitboard_t occupancy = board->occupancy[WHITE] | board->occupancy[BLACK];
+  bitboard_t candidates;
+  switch (piece_type) {
+    case KNIGHT: candidates = knight_attacks[end]; break;
+    case BISHOP: candidates = bishop_attacks(end, occupancy); break;
+    case ROOK: candidates = rook_attacks(end, occupancy); break;
+    case QUEEN: candidates = queen_attacks(end, occupancy); break;
+    case KING: candidates = king_attacks[end]; break;
+    default:
+      if (from_col >= 0) {
+        candidates = pawn_attacks[!color][end];
+      } else if (color == WHITE) {
+        candidates = (SQUARE_BB(end) >> 8) | (SQUARE_BB(end) >> 16);
+      } else {
+        candidates = (SQUARE_BB(end) << 8) | (SQUARE_BB(end) << 16);
+      }
+      break;
+  }
+  candidates &= board->pieces[color][piece_type];
+  if (from_col >= 0) {
+    candidates &= COL_0_BB << from_col;
+  }
+  if (from_row >= 0) {
+    candidates &= ROW_BB(from_row);
+  }
+
+  while (candidates) {
+    int start = pop_lsb(&candidates);
+    move_t move;
+    if (promotion != PAWN) {
+      move = ENCODE_PROMOTION(start, end, promotion);
+    } else if (piece_type == PAWN && end == game->en_passant_square && SQUARE_COL(start) != SQUARE_COL(end)) {
+      move = ENCODE_MOVE(start, end, MOVE_ENPASSANT);
+    } else {
+      move = ENCODE_MOVE(start, end, MOVE_NORMAL);
+    }
+    if (is_legal_move(game, move)) {
+      return move;
+    }
+  }
+  return NO_MOVE;
+}
+
+static void reset_game_state(pgn_worker_t *worker) {
+  worker->fen[0] = '\0';
+  worker->result = PGN_RESULT_UNKNOWN;
+  worker->in_game = false;
+  worker->replaying = false;
+  worker->failed = false;
+  worker->in_comment = false;
+  worker->variation_depth = 0;
+}
+
+static void begin_replay(pgn_worker_t *worker) {
+  worker->in_game = true;
+  worker->replaying = true;
+  if (!load_fen(&worker->game, worker->fen[0] ? worker->fen : STARTING_FEN)) {
+    worker->failed = true;
+  }
+}
+
+static void finish_game(pgn_worker_t *worker) {
+  pgn_reader_t *reader = worker->reader;
+
+  if (!worker->in_game) {
+    return;
+  }
+  if (!worker->replaying) {
+    begin_replay(worker);
+  }
+  if (worker->failed) {
+    worker->stats.invalid++;
+  } else {
+    reader->callback(&worker->game, NO_MOVE, worker->result, worker->thread_index, reader->arg);
+    worker->stats.positions++;
+    worker->stats.games++;
+  }
+  reset_game_state(worker);
+}
+
+static void play_san(pgn_worker_t *worker, const char *token, size_t length) {
+  pgn_reader_t *reader = worker->reader;
+
+  if (!worker->replaying) {
+    begin_replay(worker);
+  }
+  if (worker->failed) {
+    return;
+  }
+  move_t move = parse_san(&worker->game, token, length);
+  if (move == NO_MOVE) {
+    worker->failed = true;
+    return;
+  }
+  reader->callback(&worker->game, move, worker->result, worker->thread_index, reader->arg);
+  worker->stats.positions++;
+  make_move(&worker->game, move);
+}
+
+static void parse_tag(pgn_worker_t *worker, const char *line, const char *end) {
+  const char *name = line + 1;
+  const char *cursor = name;
+
+  while (cursor < end && *cursor != ' ' && *cursor != ']') {
+    cursor++;
+  }
+  size_t name_length = cursor - name;
+  const char *value = memchr(cursor, '"', end - cursor);
+  if (value == NULL) {
+    return;
+  }
+  value++;
+  const char *value_end = memchr(value, '"', end - value);
+  if (value_end == NULL) {
+    return;
+  }
+  size_t value_length = value_end - value;
+  if (name_length == 3 && memcmp(name, "FEN", 3) == 0 && value_length <= MAX_FEN_LENGTH) {
+    memcpy(worker->fen, value, value_length);
+    worker->fen[value_length] = '\0';
+  } else if (name_length == 6 && memcmp(name, "Result", 6) == 0) {
+    worker->result = parse_result(value, value_length);
+  }
+}
+
+static void parse_movetext(pgn_worker_t *worker, const char *cursor, const char *end) {
+  while (cursor < end) {
+    char c = *cursor;
+    if (worker->in_comment) {
+      const char *close = memchr(cursor, '}', end - cursor);
+      if (close == NULL) {
+        return;
+      }
+      worker->in_comment = false;
+      cursor = close + 1;
+      continue;
+    }
+    if (c == '{') {
+      worker->in_comment = true;
+      cursor++;
+      continue;
+    } else if (c == ';') {
+      return;
+    } else if (c == '(') {
+      worker->variation_depth++;
+      cursor++;
+      continue;
+    } else if (c == ')') {
+      if (worker->variation_depth > 0) {
+        worker->variation_depth--;
+      }
+      cursor++;
+      continue;
+    } else if (c == ' ' || c == '\t' || c == '}') {
+      cursor++;
+      continue;
+    }
+
+    const char *token = cursor;
+    while (cursor < end && !is_delimiter(*cursor)) {
+      cursor++;
+    }
+    size_t length = cursor - token;
+    if (worker->variation_depth > 0 || token[0] == '$') {
+      continue;
+    }
+    int result = parse_result(token, length);
+    if (result != PGN_RESULT_UNKNOWN || (length == 1 && token[0] == '*')) {
+      if (worker->result == PGN_RESULT_UNKNOWN) {
+        worker->result = result;
+      }
+      worker->in_game = true;
+      finish_game(worker);
+      continue;
+    }
+    if (token[0] >= '1' && token[0] <= '9') {
+      while (length > 0 && ((*token >= '0' && *token <= '9') || *token == '.')) {
+        token++;
+        length--;
+      }
+    }
+    while (length > 0 && *token == '.') {
+      token++;
+      length--;
+    }
+    if (length > 0) {
+      play_san(worker, token, length);
+    }
+  }
+}
+
+static void parse_chunk(pgn_worker_t *worker, const char *start, const char *end) {
+  while (start < end) {
+    const char *newline = memchr(start, '\n', end - start);
+    const char *line_end = newline ? newline : end;
+    const char *content_end = (line_end > start && line_end[-1] == '\r') ? line_end - 1 : line_end;
+    if (worker->in_comment || (start < content_end && start[0] != '[' && start[0] != '%')) {
+      parse_movetext(worker, start, content_end);
+    } else if (start < content_end && start[0] == '[') {
+      if (worker->replaying) {
+        finish_game(worker);
+      }
+      worker->in_game = true;
+      parse_tag(worker, start, content_end);
+    }
+    start = line_end + 1;
+  }
+  finish_game(worker);
+}
+
+static void *pgn_worker_thread(void *arg) {
+  pgn_worker_t *worker = (pgn_worker_t*) arg;
+  pgn_reader_t *reader = worker->reader;
+  uintptr_t page_mask = (uintptr_t) sysconf(_SC_PAGESIZE) - 1;
+  size_t chunk;
+
+  while ((chunk = atomic_fetch_add_explicit(&reader->next_chunk, 1, memory_order_relaxed)) < reader->chunk_count) {
+    const char *start = game_start_at_or_after(reader->data, reader->size, chunk * CHUNK_SIZE);
+    const char *end = game_start_at_or_after(reader->data, reader->size, (chunk + 1) * CHUNK_SIZE);
+    parse_chunk(worker, start, end);
+    if (end > start) {
+      uintptr_t page_start = (uintptr_t) start & ~page_mask;
+      madvise((void*) page_start, (uintptr_t) end - page_start, MADV_DONTNEED);
+    }
+  }
+  return NULL;
+}
+
+bool load_pgn_file(const char *path, int thread_count, pgn_callback_t callback, void *arg, pgn_stats_t *stats) {
+  pgn_reader_t reader;
+  struct stat file_stat;
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0) {
+    return false;
+  }
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return false;
+  }
+  stats->games = 0;
+  stats->positions = 0;
+  stats->invalid = 0;
+  if (file_stat.st_size == 0) {
+    close(fd);
+    return true;
+  }
+
+  reader.size = (size_t) file_stat.st_size;
+  reader.data = (const char*)mmap(NULL, reader.size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (reader.data == MAP_FAILED) {
+    return false;
+  }
+  madvise((void*) reader.data, reader.size, MADV_SEQUENTIAL);
+  reader.chunk_count = (reader.size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  atomic_init(&reader.next_chunk, 0);
+  reader.callback = callback;
+  reader.arg = arg;
+
+  if (thread_count < 1) {
+    thread_count = 1;
+  }
+  if ((size_t) thread_count > reader.chunk_count) {
+    thread_count = (int) reader.chunk_count;
+  }
+  pgn_worker_t *workers = (pgn_worker_t*)calloc(thread_count, sizeof(pgn_worker_t));
+  for (int i = 0; i < thread_count; i++) {
+    workers[i].reader = &reader;
+    workers[i].thread_index = i;
+    init_game(&workers[i].game);
+    reset_game_state(&workers[i]);
+  }
+  for (int i = 1; i < thread_count; i++) {
+    pthread_create(&workers[i].thread, NULL, pgn_worker_thread, &workers[i]);
+  }
+  pgn_worker_thread(&workers[0]);
+  for (int i = 0; i < thread_count; i++) {
+    if (i > 0) {
+      pthread_join(workers[i].thread, NULL);
+    }
+    stats->games += workers[i].stats.games;
+    stats->positions += workers[i].stats.positions;
+    stats->invalid += workers[i].stats.invalid;
+    free_game(&workers[i].game);
+  }
+
+  free(workers);
+  munmap((void*) reader.data, reader.size);
+  return true;
+}
@@ -0,0 +1,22 @@
+#ifndef PGN_H
+#define PGN_H
+
+#include "game.h"
+
+#define PGN_RESULT_UNKNOWN 0
+#define PGN_RESULT_WHITE_WIN 1
+#define PGN_RESULT_BLACK_WIN 2
+#define PGN_RESULT_DRAW 3
+
+typedef void (*pgn_callback_t)(game_t *game, move_t move, int result, int thread_index, void *arg);
+
+typedef struct pgn_stats {
+  unsigned long long games;
+  unsigned long long positions;
+  unsigned long long invalid;
+} pgn_stats_t;
+
+move_t parse_san(game_t *game, const char *san, size_t length);
+bool load_pgn_file(const char *path, int thread_count, pgn_callback_t callback, void *arg, pgn_stats_t *stats);
+
+#endif
@@ -0,0 +1,616 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "eval.h"
+#include "movepick.h"
+#include "nnue.h"
+#include "search.h"
+#include "see.h"
+#include "stats.h"
+#include "syzygy.h"
+#include "tt.h"
+
+#define ASPIRATION_WINDOW 25
+#define CHECK_INTERVAL 1024
+#define INFO_INTERVAL_MS 1000
+#define DELTA_MARGIN 200
+
+#define MAX_HISTORY (1 << 26)
+
+typedef struct search_state search_state_t;
+
+typedef struct search_shared {
+  const search_limits_t *limits;
+  transposition_table_t *tt;
+  struct timespec start;
+  atomic_bool stop;
+  long last_info_ms;
+  long last_stats_ms;
+  bool pondering;
+  long ponderhit_ms;
+  search_state_t *threads;
+  int thread_count;
+  move_list_t root_moves;
+  bool tb_root;
+  int tb_wdl;
+} search_shared_t;
+
+struct search_state {
+  search_shared_t *shared;
+  int thread_index;
+  pthread_t thread;
+  game_t *game;
+  game_t game_copy;
+  _Atomic unsigned long long nodes;
+  bool stopped;
+  search_result_t result;
+  move_t root_move;
+  move_t killers[MAX_PLY][2];
+  int history[2][64][64];
+  move_t pv[MAX_PLY][MAX_PLY];
+  int pv_length[MAX_PLY];
+  search_stats_t stats;
+  pawn_table_t *pawn_table;
+};
+
+typedef struct pawn_table_pool {
+  pthread_mutex_t mutex;
+  int count;
+  int capacity;
+  pawn_table_t **entries;
+} pawn_table_pool_t;
+
+/*
+ * Pawn tables outlive a single search so the cache stays warm from move
+ * to move. Each search thread checks one out and returns it when done,
+ * which keeps concurrent searches from sharing a table.
+ */
+static pawn_table_pool_t pawn_table_pool = { PTHREAD_MUTEX_INITIALIZER, 0, 0, NULL };
+
+static pawn_table_t *acquire_pawn_table(void) {
+  pawn_table_t *table = NULL;
+  pthread_mutex_lock(&pawn_table_pool.mutex);
+  if (pawn_table_pool.count > 0) {
+    table = pawn_table_pool.entries[--pawn_table_pool.count];
+  }
+  pthread_mutex_unlock(&pawn_table_pool.mutex);
+  return table ? table : (pawn_table_t*)calloc(1, sizeof(pawn_table_t));
+}
+
+static void release_pawn_table(pawn_table_t *table) {
+  pthread_mutex_lock(&pawn_table_pool.mutex);
+  if (pawn_table_pool.count == pawn_table_pool.capacity) {
+    pawn_table_pool.capacity = pawn_table_pool.capacity ? pawn_table_pool.capacity * 2 : 8;
+    pawn_table_pool.entries = (pawn_table_t**)realloc(pawn_table_pool.entries, pawn_table_pool.capacity * sizeof(pawn_table_t*));
+  }
+  pawn_table_pool.entries[pawn_table_pool.count++] = table;
+  pthread_mutex_unlock(&pawn_table_pool.mutex);
+}
+
+static long elapsed_ms(search_shared_t *shared) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - shared->start.tv_sec) * 1000 + (now.tv_nsec - shared->start.tv_nsec) / 1000000;
+}
+
+static unsigned long long total_nodes(search_shared_t *shared) {
+  unsigned long long nodes = 0;
+  for (int i = 0; i < shared->thread_count; i++) {
+    nodes += atomic_load_explicit(&shared->threads[i].nodes, memory_order_relaxed);
+  }
+  return nodes;
+}
+
+static bool is_pondering(const search_limits_t *limits) {
+  return limits->pondering && atomic_load_explicit(limits->pondering, memory_order_relaxed);
+}
+
+/* Only called from thread 0; the move's time budget starts at ponderhit. */
+static long search_time_ms(search_shared_t *shared) {
+  long time_ms = elapsed_ms(shared);
+  if (shared->pondering && !is_pondering(shared->limits)) {
+    shared->pondering = false;
+    shared->ponderhit_ms = time_ms;
+  }
+  return shared->pondering ? 0 : time_ms - shared->ponderhit_ms;
+}
+
+static int tb_score(int wdl, int ply) {
+  return (wdl == TB_WIN) ? TB_WIN_SCORE - ply : (wdl == TB_LOSS) ? -TB_WIN_SCORE + ply : 0;
+}
+
+/* At a tablebase root, non-mate scores report the tablebase result instead. */
+static int reported_score(search_shared_t *shared, int score) {
+  if (shared->tb_root && score < MATE_BOUND && score > -MATE_BOUND) {
+    return tb_score(shared->tb_wdl, 1);
+  }
+  return score;
+}
+
+static void send_info(search_state_t *state, int depth, int score, const move_t *pv, int pv_length) {
+  search_shared_t *shared = state->shared;
+  long time_ms = elapsed_ms(shared);
+  search_info_t info = { depth, reported_score(shared, score), total_nodes(shared), time_ms, tt_hashfull(shared->tt), pv, pv_length };
+  shared->last_info_ms = time_ms;
+  shared->limits->info(&info, shared->limits->info_arg);
+}
+
+#ifdef ENABLE_STATS
+static void dump_stats(search_shared_t *shared) {
+  search_stats_t stats;
+  char buffer[512];
+  memset(&stats, 0, sizeof(search_stats_t));
+  for (int i = 0; i < shared->thread_count; i++) {
+    stats_accumulate(&stats, &shared->threads[i].stats);
+  }
+  format_search_stats(&stats, buffer, sizeof(buffer));
+  fprintf(stderr, "stats %s\n", buffer);
+}
+#endif
+
+static void check_limits(search_state_t *state) {
+  search_shared_t *shared = state->shared;
+  const search_limits_t *limits = shared->limits;
+  if (state->thread_index == 0) {
+    long time_ms = elapsed_ms(shared);
+    if ((limits->nodes && total_nodes(shared) >= limits->nodes) ||
+        (limits->time_ms && search_time_ms(shared) >= limits->time_ms) ||
+        (limits->stop && atomic_load_explicit(limits->stop, memory_order_relaxed))) {
+      atomic_store_explicit(&shared->stop, true, memory_order_relaxed);
+    }
+    if (limits->info && time_ms - shared->last_info_ms >= INFO_INTERVAL_MS) {
+      send_info(state, state->result.depth, state->result.score, NULL, 0);
+    }
+#ifdef ENABLE_STATS
+    if (time_ms - shared->last_stats_ms >= INFO_INTERVAL_MS) {
+      shared->last_stats_ms = time_ms;
+      dump_stats(shared);
+    }
+#endif
+  }
+  if (atomic_load_explicit(&shared->stop, memory_order_relaxed)) {
+    state->stopped = true;
+  }
+}
+
+static void count_node(search_state_t *state) {
+  unsigned long long nodes = atomic_load_explicit(&state->nodes, memory_order_relaxed) + 1;
+  atomic_store_explicit(&state->nodes, nodes, memory_order_relaxed);
+  if ((nodes & (CHECK_INTERVAL - 1)) == 0) {
+    check_limits(state);
+  }
+}
+
+/* Mate and tablebase scores are stored relative to the node, not the root. */
+static int score_to_tt(int score, int ply) {
+  if (score >= TB_BOUND) {
+    return score + ply;
+  } else if (score <= -TB_BOUND) {
+    return score - ply;
+  }
+  return score;
+}
+
+static int score_from_tt(int score, int ply) {
+  if (score >= TB_BOUND) {
+    return score - ply;
+  } else if (score <= -TB_BOUND) {
+    return score + ply;
+  }
+  return score;
+}
+
+static bool has_non_pawn_material(game_t *game) {
+  bitboard_t *pieces = game->position.pieces[game->color_to_move];
+  return (pieces[KNIGHT] | pieces[BISHOP] | pieces[ROOK] | pieces[QUEEN]) != 0;
+}
+
+static bool is_search_draw(game_t *game) {
+  return count_repetitions(game) > 0 || is_fifty_move_draw(game);
+}
+
+static bool is_root_move(search_shared_t *shared, move_t move) {
+  for (int i = 0; i < shared->root_moves.count; i++) {
+    if (shared->root_moves.entries[i] == move) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static int captured_value(game_t *game, move_t move) {
+  if (MOVE_FLAGS(move) == MOVE_ENPASSANT) {
+    return piece_values[PAWN];
+  } else if (game->position.occupancy[!game->color_to_move] & SQUARE_BB(MOVE_END(move))) {
+    return piece_values[piece_type_at(&game->position, !game->color_to_move, MOVE_END(move))];
+  }
+  return 0;
+}
+
+static void update_quiet_stats(search_state_t *state, move_t move, int ply, int depth) {
+  int *history = &state->history[state->game->color_to_move][MOVE_START(move)][MOVE_END(move)];
+  if (state->killers[ply][0] != move) {
+    state->killers[ply][1] = state->killers[ply][0];
+    state->killers[ply][0] = move;
+  }
+  *history += depth * depth;
+  if (*history >= MAX_HISTORY) {
+    for (int color = 0; color < 2; color++) {
+      for (int start = 0; start < 64; start++) {
+        for (int end = 0; end < 64; end++) {
+          state->history[color][start][end] /= 2;
+        }
+      }
+    }
+  }
+}
+
+static void update_pv(search_state_t *state, move_t move, int ply) {
+  state->pv[ply][ply] = move;
+  for (int i = ply + 1; i < state->pv_length[ply + 1]; i++) {
+    state->pv[ply][i] = state->pv[ply + 1][i];
+  }
+  state->pv_length[ply] = state->pv_length[ply + 1];
+}
+
+static int quiescence(search_state_t *state, int ply, int alpha, int beta) {
+  game_t *game = state->game;
+  bool pv_node = beta - alpha > 1;
+  move_picker_t picker;
+  tt_data_t tt_entry;
+
+  count_node(state);
+  STATS_INC(qnodes);
+  if (state->stopped) {
+    return 0;
+  }
+  state->pv_length[ply] = ply;
+
+  bool tt_hit = tt_probe(state->shared->tt, game->key, &tt_entry);
+  if (tt_hit && !pv_node) {
+    int tt_score = score_from_tt(tt_entry.score, ply);
+    if (tt_entry.bound == BOUND_EXACT ||
+        (tt_entry.bound == BOUND_LOWER && tt_score >= beta) ||
+        (tt_entry.bound == BOUND_UPPER && tt_score <= alpha)) {
+      return tt_score;
+    }
+  }
+
+  bool in_check = is_in_check(game);
+  int original_alpha = alpha;
+  int best_score = -INFINITE_SCORE;
+  int static_eval = 0;
+  move_t best_move = NO_MOVE;
+  if (!in_check) {
+    static_eval = (tt_hit && tt_entry.eval != TT_NO_EVAL) ? tt_entry.eval : evaluate(game);
+    best_score = static_eval;
+    if (best_score >= beta || ply >= MAX_PLY - 1) {
+      return best_score;
+    }
+    if (best_score > alpha) {
+      alpha = best_score;
+    }
+  } else if (ply >= MAX_PLY - 1) {
+    return evaluate(game);
+  }
+
+  init_quiescence_picker(&picker, game, tt_hit ? tt_entry.move : NO_MOVE, state->history[game->color_to_move], in_check);
+  move_t move;
+  while ((move = next_move(&picker)) != NO_MOVE) {
+    if (!in_check) {
+      if (!MOVE_IS_PROMOTION(move) && static_eval + captured_value(game, move) + DELTA_MARGIN <= alpha) {
+        continue;
+      }
+      if (!see_ge(game, move, 0)) {
+        continue;
+      }
+    }
+    make_move(game, move);
+    STATS_INC(moves_searched);
+    tt_prefetch(state->shared->tt, game->key);
+    int score = -quiescence(state, ply + 1, -beta, -alpha);
+    unmake_move(game);
+    if (state->stopped) {
+      return 0;
+    }
+    if (score > best_score) {
+      best_score = score;
+      if (score > alpha) {
+        alpha = score;
+        best_move = move;
+        update_pv(state, move, ply);
+        if (score >= beta) {
+          break;
+        }
+      }
+    }
+  }
+  if (in_check && best_score == -INFINITE_SCORE) {
+    return -MATE_SCORE + ply;
+  }
+
+  int bound = (best_score >= beta) ? BOUND_LOWER : (alpha > original_alpha) ? BOUND_EXACT : BOUND_UPPER;
+  tt_store(state->shared->tt, game->key, best_move, score_to_tt(best_score, ply), static_eval, 0, bound);
+  return best_score;
+}
+
+static int negamax(search_state_t *state, int depth, int ply, int alpha, int beta, bool can_null) {
+  game_t *game = state->game;
+  bool pv_node = beta - alpha > 1;
+  move_picker_t picker;
+  tt_data_t tt_entry;
+
+  if (depth <= 0) {
+    return quiescence(state, ply, alpha, beta);
+  }
+  count_node(state);
+  STATS_INC(nodes);
+  if (state->stopped) {
+    return 0;
+  }
+  state->pv_length[ply] = ply;
+  if (ply > 0 && is_search_draw(game)) {
+    return 0;
+  }
+  if (ply >= MAX_PLY - 1) {
+    return evaluate(game);
+  }
+
+  bool in_check = is_in_check(game);
+  if (in_check) {
+    depth++;
+  }
+
+  bool tt_hit = tt_probe(state->shared->tt, game->key, &tt_entry);
+  move_t tt_move = tt_hit ? tt_entry.move : NO_MOVE;
+  if (tt_hit && !pv_node && tt_entry.depth >= depth) {
+    int tt_score = score_from_tt(tt_entry.score, ply);
+    if (tt_entry.bound == BOUND_EXACT ||
+        (tt_entry.bound == BOUND_LOWER && tt_score >= beta) ||
+        (tt_entry.bound == BOUND_UPPER && tt_score <= alpha)) {
+      return tt_score;
+    }
+  }
+
+  int wdl;
+  if (ply > 0 && game->halfmove_clock == 0 && piece_count(&game->position) <= syzygy_max_pieces() &&
+      syzygy_probe_wdl(game, &wdl)) {
+    int score = tb_score(wdl, ply);
+    tt_store(state->shared->tt, game->key, NO_MOVE, score_to_tt(score, ply), TT_NO_EVAL, depth, BOUND_EXACT);
+    return score;
+  }
+
+  int static_eval = 0;
+  if (!in_check) {
+    static_eval = (tt_hit && tt_entry.eval != TT_NO_EVAL) ? tt_entry.eval : evaluate(game);
+  }
+
+  if (!pv_node && !in_check && can_null && depth >= 3 && has_non_pawn_material(game) && static_eval >= beta) {
+    int reduction = 3 + depth / 6;
+    make_null_move(game);
+    tt_prefetch(state->shared->tt, game->key);
+    int score = -negamax(state, depth - 1 - reduction, ply + 1, -beta, -beta + 1, false);
+    unmake_null_move(game);
+    if (state->stopped) {
+      return 0;
+    }
+    if (score >= beta) {
+      return (score >= MATE_BOUND) ? beta : score;
+    }
+  }
+
+  init_move_picker(&picker, game, (ply == 0 && state->root_move != NO_MOVE) ? state->root_move : tt_move,
+                   state->killers[ply], state->history[game->color_to_move], in_check);
+
+  int original_alpha = alpha;
+  int best_score = -INFINITE_SCORE;
+  int moves_searched = 0;
+  move_t best_move = NO_MOVE;
+  move_t move;
+  while ((move = next_move(&picker)) != NO_MOVE) {
+    if (ply == 0 && state->shared->root_moves.count > 0 && !is_root_move(state->shared, move)) {
+      continue;
+    }
+    bool quiet = !is_capture_move(game, move) && !MOVE_IS_PROMOTION(move);
+    int i = moves_searched++;
+    int score;
+
+    make_move(game, move);
+    STATS_INC(moves_searched);
+    tt_prefetch(state->shared->tt, game->key);
+    if (i == 0) {
+      score = -negamax(state, depth - 1, ply + 1, -beta, -alpha, true);
+    } else {
+      int reduction = 0;
+      if (depth >= 3 && i >= 3 && picker.stage == STAGE_QUIETS && !is_in_check(game)) {
+        reduction = 1 + (depth >= 6) + (i >= 12);
+        if (pv_node && reduction > 1) {
+          reduction--;
+        }
+      }
+      score = -negamax(state, depth - 1 - reduction, ply + 1, -alpha - 1, -alpha, true);
+      if (score > alpha && reduction > 0) {
+        score = -negamax(state, depth - 1, ply + 1, -alpha - 1, -alpha, true);
+      }
+      if (score > alpha && score < beta) {
+        score = -negamax(state, depth - 1, ply + 1, -beta, -alpha, true);
+      }
+    }
+    unmake_move(game);
+    if (state->stopped) {
+      return 0;
+    }
+
+    if (score > best_score) {
+      best_score = score;
+      if (score > alpha) {
+        alpha = score;
+        best_move = move;
+        update_pv(state, move, ply);
+        if (score >= beta) {
+          STATS_CUTOFF(i);
+          if (quiet) {
+            update_quiet_stats(state, move, ply, depth);
+          }
+          break;
+        }
+      }
+    }
+  }
+  if (moves_searched == 0) {
+    return in_check ? -MATE_SCORE + ply : 0;
+  }
+
+  int bound = (best_score >= beta) ? BOUND_LOWER : (alpha > original_alpha) ? BOUND_EXACT : BOUND_UPPER;
+  tt_store(state->shared->tt, game->key, best_move, score_to_tt(best_score, ply), static_eval, depth, bound);
+  return best_score;
+}
+
+static void iterative_deepening(search_state_t *state) {
+  const search_limits_t *limits = state->shared->limits;
+  search_result_t *result = &state->result;
+  int max_depth = (limits->depth > 0 && limits->depth < MAX_DEPTH) ? limits->depth : MAX_DEPTH;
+
+  stats_attach(&state->stats);
+
+  for (int depth = 1 + (state->thread_index & 1); depth <= max_depth; depth++) {
+    int delta = ASPIRATION_WINDOW;
+    int alpha = -INFINITE_SCORE;
+    int beta = INFINITE_SCORE;
+    int score;
+
+    if (depth >= 5) {
+      alpha = result->score - delta;
+      beta = result->score + delta;
+    }
+    while (true) {
+      score = negamax(state, depth, 0, alpha, beta, false);
+      if (state->stopped) {
+        break;
+      }
+      if (score <= alpha) {
+        beta = (alpha + beta) / 2;
+        alpha = (score - delta > -INFINITE_SCORE) ? score - delta : -INFINITE_SCORE;
+      } else if (score >= beta) {
+        beta = (score + delta < INFINITE_SCORE) ? score + delta : INFINITE_SCORE;
+      } else {
+        break;
+      }
+      delta *= 2;
+    }
+    if (state->stopped && result->best_move != NO_MOVE) {
+      break;
+    }
+
+    state->root_move = state->pv[0][0];
+    result->best_move = state->pv[0][0];
+    result->ponder_move = (state->pv_length[0] > 1) ? state->pv[0][1] : NO_MOVE;
+    result->score = score;
+    result->depth = depth;
+    if (state->thread_index == 0 && limits->info) {
+      send_info(state, depth, score, state->pv[0], state->pv_length[0]);
+    }
+    if (state->stopped ||
+        (state->thread_index == 0 && limits->time_ms && search_time_ms(state->shared) >= limits->time_ms / 2) ||
+        (score >= MATE_BOUND && MATE_SCORE - score <= depth) ||
+        (score <= -MATE_BOUND && MATE_SCORE + score <= depth)) {
+      break;
+    }
+  }
+  stats_attach(NULL);
+}
+
+/*
+ * Keeps the tablebase-preserving moves that were also requested; when none
+ * were, the requested moves are searched without the tablebase score.
+ */
+static void restrict_root_moves(search_shared_t *shared, const move_list_t *search_moves) {
+  move_list_t root_moves;
+
+  init_move_list(&root_moves);
+  for (int i = 0; i < search_moves->count; i++) {
+    if (!shared->tb_root || is_root_move(shared, search_moves->entries[i])) {
+      add_to_move_list(&root_moves, search_moves->entries[i]);
+    }
+  }
+  if (root_moves.count == 0) {
+    root_moves = *search_moves;
+    shared->tb_root = false;
+  }
+  shared->root_moves = root_moves;
+}
+
+static void *helper_thread(void *arg) {
+  iterative_deepening((search_state_t*) arg);
+  return NULL;
+}
+
+search_result_t search(game_t *game, const search_limits_t *limits) {
+  search_shared_t shared;
+  int thread_count = (limits->threads > 1) ? limits->threads : 1;
+
+  shared.tb_root = syzygy_probe_root(game, &shared.root_moves, &shared.tb_wdl);
+  if (!shared.tb_root) {
+    init_move_list(&shared.root_moves);
+  }
+  if (limits->search_moves.count > 0) {
+    restrict_root_moves(&shared, &limits->search_moves);
+  }
+  shared.limits = limits;
+  shared.tt = limits->tt ? limits->tt : &tt;
+  shared.thread_count = thread_count;
+  shared.threads = (search_state_t*)calloc(thread_count, sizeof(search_state_t));
+  atomic_init(&shared.stop, false);
+  shared.last_info_ms = 0;
+  shared.pondering = is_pondering(limits);
+  shared.ponderhit_ms = 0;
+  shared.last_stats_ms = 0;
+  clock_gettime(CLOCK_MONOTONIC, &shared.start);
+  tt_new_search(shared.tt);
+
+  for (int i = 0; i < thread_count; i++) {
+    search_state_t *state = &shared.threads[i];
+    state->shared = &shared;
+    state->thread_index = i;
+    state->root_move = (shared.root_moves.count > 0) ? shared.root_moves.entries[0] : NO_MOVE;
+    copy_game(&state->game_copy, game);
+    if (nnue_is_loaded()) {
+      nnue_attach(&state->game_copy);
+    }
+    state->pawn_table = acquire_pawn_table();
+    state->game_copy.pawn_table = state->pawn_table;
+    state->game = &state->game_copy;
+  }
+  for (int i = 1; i < thread_count; i++) {
+    pthread_create(&shared.threads[i].thread, NULL, helper_thread, &shared.threads[i]);
+  }
+  iterative_deepening(&shared.threads[0]);
+  atomic_store(&shared.stop, true);
+  for (int i = 1; i < thread_count; i++) {
+    pthread_join(shared.threads[i].thread, NULL);
+  }
+
+  search_result_t result = shared.threads[0].result;
+  if (result.best_move == NO_MOVE && shared.root_moves.count > 0) {
+    result.best_move = shared.root_moves.entries[0];
+  } else if (result.best_move == NO_MOVE) {
+    move_list_t move_list;
+    init_move_list(&move_list);
+    calculate_legal_moves(game, &move_list);
+    if (move_list.count > 0) {
+      result.best_move = move_list.entries[0];
+    }
+  }
+  result.score = reported_score(&shared, result.score);
+  result.nodes = total_nodes(&shared);
+  for (int i = 0; i < thread_count; i++) {
+    stats_record(&shared.threads[i].stats);
+    free_game(&shared.threads[i].game_copy);
+    release_pawn_table(shared.threads[i].pawn_table);
+  }
+  free(shared.threads);
+  return result;
+}
@@ -0,0 +1,56 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdatomic.h>
+
+#include "game.h"
+#include "tt.h"
+
+#define MAX_PLY 128
+#define MAX_DEPTH 64
+#define INFINITE_SCORE 32001
+#define MATE_SCORE 32000
+#define MATE_BOUND (MATE_SCORE - MAX_PLY)
+#define TB_WIN_SCORE (MATE_BOUND - MAX_PLY)
+#define TB_BOUND (TB_WIN_SCORE - MAX_PLY)
+
+typedef struct search_info {
+  int depth;
+  int score;
+  unsigned long long nodes;
+  long time_ms;
+  int hashfull;
+  const move_t *pv;
+  int pv_length;
+} search_info_t;
+
+typedef void (*search_info_callback_t)(const search_info_t *info, void *arg);
+
+typedef struct search_limits {
+  int depth;
+  unsigned long long nodes;
+  int time_ms;
+  int threads;
+  atomic_bool *stop;
+  atomic_bool *pondering;
+  search_info_callback_t info;
+  void *info_arg;
+  transposition_table_t *tt;
+  move_list_t search_moves;
+} search_limits_t;
+
+typedef struct search_result {
+  move_t best_move;
+  move_t ponder_move;
+  int score;
+  int depth;
+  unsigned long long nodes;
+} search_result_t;
+
+/*
+ * A NULL limits->tt searches the global table. A non-empty search_moves
+ * restricts the root to those moves.
+ */
+search_result_t search(game_t *game, const search_limits_t *limits);
+
+#endif
@@ -0,0 +1,84 @@
+#include "eval.h"
+#include "see.h"
+
+#define SEE_KING_VALUE 20000
+#define MAX_EXCHANGES 32
+
+static int see_value(piece_type_t piece_type) {
+  return (piece_type == KING) ? SEE_KING_VALUE : piece_values[piece_type];
+}
+
+static piece_type_t least_valuable_attacker(board_t *board, bitboard_t attackers, color_t color, int *square) {
+  for (int piece_type = PAWN; piece_type <= KING; piece_type++) {
+    bitboard_t bb = attackers & board->pieces[color][piece_type];
+    if (bb) {
+      *square = lsb(bb);
+      return (piece_type_t) piece_type;
+    }
+  }
+  return -1;
+}
+
+int see(game_t *game, move_t move) {
+  board_t *board = &game->position;
+  int start = MOVE_START(move);
+  int end = MOVE_END(move);
+  int flags = MOVE_FLAGS(move);
+  color_t color = game->color_to_move;
+  bitboard_t occupancy = board->occupancy[WHITE] | board->occupancy[BLACK];
+  bitboard_t diagonal_sliders = board->pieces[WHITE][BISHOP] | board->pieces[BLACK][BISHOP] |
+                                board->pieces[WHITE][QUEEN] | board->pieces[BLACK][QUEEN];
+  bitboard_t straight_sliders = board->pieces[WHITE][ROOK] | board->pieces[BLACK][ROOK] |
+                                board->pieces[WHITE][QUEEN] | board->pieces[BLACK][QUEEN];
+  int gain[MAX_EXCHANGES];
+  int depth = 0;
+
+  if (flags == MOVE_KING_SIDE_CASTLE || flags == MOVE_QUEEN_SIDE_CASTLE) {
+    return 0;
+  }
+
+  piece_type_t attacker = piece_type_at(board, color, start);
+  if (flags == MOVE_ENPASSANT) {
+    gain[0] = piece_values[PAWN];
+    occupancy ^= SQUARE_BB(SQUARE(SQUARE_ROW(start), SQUARE_COL(end)));
+  } else if (board->occupancy[!color] & SQUARE_BB(end)) {
+    gain[0] = piece_values[piece_type_at(board, !color, end)];
+  } else {
+    gain[0] = 0;
+  }
+  if (MOVE_IS_PROMOTION(move)) {
+    attacker = MOVE_PROMOTED_PIECE_TYPE(move);
+    gain[0] += piece_values[attacker] - piece_values[PAWN];
+  }
+
+  bitboard_t attackers = attackers_to(board, end, occupancy);
+  while (true) {
+    depth++;
+    gain[depth] = see_value(attacker) - gain[depth - 1];
+    if ((-gain[depth - 1] > gain[depth] ? -gain[depth - 1] : gain[depth]) < 0 || depth == MAX_EXCHANGES - 1) {
+      break;
+    }
+    occupancy ^= SQUARE_BB(start);
+    attackers |= (bishop_attacks(end, occupancy) & diagonal_sliders) | (rook_attacks(end, occupancy) & straight_sliders);
+    attackers &= occupancy;
+    color = !color;
+    attacker = least_valuable_attacker(board, attackers, color, &start);
+    if ((int) attacker == -1) {
+      break;
+    }
+    if (attacker == KING && (attackers & board->occupancy[!color])) {
+      break;
+    }
+  }
+
+  while (--depth) {
+    if (-gain[depth - 1] < gain[depth]) {
+      gain[depth - 1] = -gain[depth];
+    }
+  }
+  return gain[0];
+}
+
+bool see_ge(game_t *game, move_t move, int threshold) {
+  return see(game, move) >= threshold;
+}
@@ -0,0 +1,9 @@
+#ifndef SEE_H
+#define SEE_H
+
+#include "game.h"
+
+int see(game_t *game, move_t move);
+bool see_ge(game_t *game, move_t move, int threshold);
+
+#endif
@@ -0,0 +1,86 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stats.h"
+
+#ifdef ENABLE_STATS
+_Thread_local search_stats_t *thread_stats = NULL;
+#endif
+
+static search_stats_t totals;
+static pthread_mutex_t totals_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void stats_attach(search_stats_t *stats) {
+#ifdef ENABLE_STATS
+  thread_stats = stats;
+#else
+  (void) stats;
+#endif
+}
+
+static void add_counter(_Atomic unsigned long long *total, const _Atomic unsigned long long *counter) {
+  unsigned long long value = atomic_load_explicit((_Atomic unsigned long long*) counter, memory_order_relaxed);
+  atomic_fetch_add_explicit(total, value, memory_order_relaxed);
+}
+
+void stats_accumulate(search_stats_t *total, const search_stats_t *stats) {
+  add_counter(&total->nodes, &stats->nodes);
+  add_counter(&total->qnodes, &stats->qnodes);
+  add_counter(&total->tt_probes, &stats->tt_probes);
+  add_counter(&total->tt_hits, &stats->tt_hits);
+  add_counter(&total->moves_generated, &stats->moves_generated);
+  add_counter(&total->moves_searched, &stats->moves_searched);
+  add_counter(&total->generation_ticks, &stats->generation_ticks);
+  add_counter(&total->evaluation_ticks, &stats->evaluation_ticks);
+  add_counter(&total->pawn_probes, &stats->pawn_probes);
+  add_counter(&total->pawn_hits, &stats->pawn_hits);
+  for (int i = 0; i < STATS_CUTOFF_SLOTS; i++) {
+    add_counter(&total->cutoffs[i], &stats->cutoffs[i]);
+  }
+}
+
+void stats_record(const search_stats_t *stats) {
+  pthread_mutex_lock(&totals_mutex);
+  stats_accumulate(&totals, stats);
+  pthread_mutex_unlock(&totals_mutex);
+}
+
+void get_search_stats(search_stats_t *stats) {
+  memset(stats, 0, sizeof(search_stats_t));
+  pthread_mutex_lock(&totals_mutex);
+  stats_accumulate(stats, &totals);
+  pthread_mutex_unlock(&totals_mutex);
+}
+
+void reset_search_stats(void) {
+  pthread_mutex_lock(&totals_mutex);
+  memset(&totals, 0, sizeof(search_stats_t));
+  pthread_mutex_unlock(&totals_mutex);
+}
+
+static double percent(unsigned long long part, unsigned long long whole) {
+  return whole ? 100.0 * part / whole : 0.0;
+}
+
+void format_search_stats(const search_stats_t *stats, char *buffer, size_t size) {
+  search_stats_t copy;
+  memset(&copy, 0, sizeof(search_stats_t));
+  stats_accumulate(&copy, stats);
+
+  unsigned long long cutoffs = 0;
+  for (int i = 0; i < STATS_CUTOFF_SLOTS; i++) {
+    cutoffs += copy.cutoffs[i];
+  }
+  unsigned long long ticks = copy.generation_ticks + copy.evaluation_ticks;
+  int length = snprintf(buffer, size,
+                        "nodes %llu qnodes %llu ttprobes %llu tthits %llu (%.1f%%) generated %llu searched %llu (%.1f%%) "
+                        "pawnhits %llu (%.1f%%) gen %.1f%% eval %.1f%% cutoffs %llu",
+                        copy.nodes, copy.qnodes, copy.tt_probes, copy.tt_hits, percent(copy.tt_hits, copy.tt_probes),
+                        copy.moves_generated, copy.moves_searched, percent(copy.moves_searched, copy.moves_generated),
+                        copy.pawn_hits, percent(copy.pawn_hits, copy.pawn_probes), percent(copy.generation_ticks, ticks), percent(copy.evaluation_ticks, ticks), cutoffs);
+  for (int i = 0; i < STATS_CUTOFF_SLOTS && length >= 0 && (size_t) length < size; i++) {
+    length += snprintf(buffer + length, size - length, " %.1f%s", percent(copy.cutoffs[i], cutoffs),
+                       (i == STATS_CUTOFF_SLOTS - 1) ? "+" : "");
+  }
+}
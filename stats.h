@@ -0,0 +1,71 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define STATS_CUTOFF_SLOTS 16
+
+/*
+ * Counters are only maintained when built with -DENABLE_STATS; otherwise
+ * the STATS_* macros compile to nothing. Each search thread owns a block
+ * and publishes it through stats_attach, so updates are uncontended.
+ */
+typedef struct search_stats {
+  _Atomic unsigned long long nodes;
+  _Atomic unsigned long long qnodes;
+  _Atomic unsigned long long tt_probes;
+  _Atomic unsigned long long tt_hits;
+  _Atomic unsigned long long moves_generated;
+  _Atomic unsigned long long moves_searched;
+  _Atomic unsigned long long generation_ticks;
+  _Atomic unsigned long long evaluation_ticks;
+  _Atomic unsigned long long pawn_probes;
+  _Atomic unsigned long long pawn_hits;
+  _Atomic unsigned long long cutoffs[STATS_CUTOFF_SLOTS];
+} search_stats_t;
+
+#ifdef ENABLE_STATS
+
+extern _Thread_local search_stats_t *thread_stats;
+
+static inline void stats_add(_Atomic unsigned long long *counter, unsigned long long amount) {
+  atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+static inline uint64_t stats_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+#define STATS_ADD(field, amount) do { if (thread_stats) stats_add(&thread_stats->field, (amount)); } while (0)
+#define STATS_INC(field) STATS_ADD(field, 1)
+#define STATS_CUTOFF(index) STATS_INC(cutoffs[(index) < STATS_CUTOFF_SLOTS ? (index) : STATS_CUTOFF_SLOTS - 1])
+#define STATS_TIMER_START(name) uint64_t name = stats_now()
+#define STATS_TIMER_STOP(field, name) STATS_ADD(field, stats_now() - (name))
+
+#else
+
+#define STATS_ADD(field, amount) ((void) 0)
+#define STATS_INC(field) ((void) 0)
+#define STATS_CUTOFF(index) ((void) 0)
+#define STATS_TIMER_START(name)
+#define STATS_TIMER_STOP(field, name) ((void) 0)
+
+#endif
+
+void stats_attach(search_stats_t *stats);
+void stats_accumulate(search_stats_t *total, const search_stats_t *stats);
+void stats_record(const search_stats_t *stats);
+void get_search_stats(search_stats_t *stats);
+void reset_search_stats(void);
+void format_search_stats(const search_stats_t *stats, char *buffer, size_t size);
+
+#endif
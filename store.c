@@ -0,0 +1,137 @@
+#include <string.h>
+
+#include "store.h"
+
+#define HANDLE_SLOT(handle) ((uint32_t) (handle))
+#define HANDLE_GENERATION(handle) ((uint32_t) ((handle) >> 32))
+#define ENCODE_HANDLE(slot, generation) (((uint64_t) (generation) << 32) | (slot))
+
+static stored_game_t *slot_at(game_store_t *store, uint32_t slot) {
+  return &store->blocks[slot / STORE_BLOCK_SIZE][slot % STORE_BLOCK_SIZE];
+}
+
+/* The caller holds the store mutex. */
+static stored_game_t *find_game(game_store_t *store, game_handle_t handle) {
+  uint32_t slot = HANDLE_SLOT(handle);
+  if (handle == INVALID_GAME_HANDLE || slot / STORE_BLOCK_SIZE >= (uint32_t) store->block_count) {
+    return NULL;
+  }
+  stored_game_t *stored = slot_at(store, slot);
+  return (stored->generation == HANDLE_GENERATION(handle)) ? stored : NULL;
+}
+
+static stored_game_t *lookup_game(game_store_t *store, game_handle_t handle) {
+  pthread_mutex_lock(&store->mutex);
+  stored_game_t *stored = find_game(store, handle);
+  pthread_mutex_unlock(&store->mutex);
+  return stored;
+}
+
+static bool grow_store(game_store_t *store) {
+  if (store->block_count == MAX_STORE_BLOCKS) {
+    return false;
+  }
+  stored_game_t *block = (stored_game_t*)aligned_alloc(64, STORE_BLOCK_SIZE * sizeof(stored_game_t));
+  if (block == NULL) {
+    return false;
+  }
+  uint32_t first_slot = (uint32_t) store->block_count * STORE_BLOCK_SIZE;
+  store->free_capacity = (store->block_count + 1) * STORE_BLOCK_SIZE;
+  store->free_slots = (uint32_t*)realloc(store->free_slots, sizeof(uint32_t) * store->free_capacity);
+  for (int i = STORE_BLOCK_SIZE - 1; i >= 0; i--) {
+    block[i].generation = 1;
+    store->free_slots[store->free_count++] = first_slot + i;
+  }
+  store->blocks[store->block_count++] = block;
+  return true;
+}
+
+static void save_stored_game(stored_game_t *stored, game_t *game) {
+  int count = game->halfmove_clock;
+  if (count > game->key_history_count) {
+    count = game->key_history_count;
+  }
+  if (count > FIFTY_MOVE_PLIES) {
+    count = FIFTY_MOVE_PLIES;
+  }
+  save_snapshot(game, &stored->position);
+  stored->history_count = (uint16_t) count;
+  for (int i = 0; i < count; i++) {
+    stored->history[i] = game->key_history[(game->key_history_count - count + i) & (KEY_HISTORY_SIZE - 1)];
+  }
+}
+
+void init_game_store(game_store_t *store) {
+  pthread_mutex_init(&store->mutex, NULL);
+  store->block_count = 0;
+  store->free_slots = NULL;
+  store->free_count = 0;
+  store->free_capacity = 0;
+  store->game_count = 0;
+}
+
+void free_game_store(game_store_t *store) {
+  for (int i = 0; i < store->block_count; i++) {
+    free(store->blocks[i]);
+  }
+  free(store->free_slots);
+  store->block_count = 0;
+  store->free_slots = NULL;
+  store->free_count = 0;
+  store->free_capacity = 0;
+  store->game_count = 0;
+  pthread_mutex_destroy(&store->mutex);
+}
+
+game_handle_t store_add_game(game_store_t *store, game_t *game) {
+  pthread_mutex_lock(&store->mutex);
+  if (store->free_count == 0 && !grow_store(store)) {
+    pthread_mutex_unlock(&store->mutex);
+    return INVALID_GAME_HANDLE;
+  }
+  uint32_t slot = store->free_slots[--store->free_count];
+  store->game_count++;
+  stored_game_t *stored = slot_at(store, slot);
+  pthread_mutex_unlock(&store->mutex);
+
+  save_stored_game(stored, game);
+  return ENCODE_HANDLE(slot, stored->generation);
+}
+
+bool store_load_game(game_store_t *store, game_handle_t handle, game_t *game) {
+  stored_game_t *stored = lookup_game(store, handle);
+  if (stored == NULL) {
+    return false;
+  }
+  load_snapshot(game, &stored->position);
+  memcpy(game->key_history, stored->history, sizeof(uint64_t) * stored->history_count);
+  game->key_history_count = stored->history_count;
+  return true;
+}
+
+bool store_save_game(game_store_t *store, game_handle_t handle, game_t *game) {
+  stored_game_t *stored = lookup_game(store, handle);
+  if (stored == NULL) {
+    return false;
+  }
+  save_stored_game(stored, game);
+  return true;
+}
+
+void store_remove_game(game_store_t *store, game_handle_t handle) {
+  pthread_mutex_lock(&store->mutex);
+  stored_game_t *stored = find_game(store, handle);
+  if (stored != NULL) {
+    stored->generation = (stored->generation == UINT32_MAX) ? 1 : stored->generation + 1;
+    store->free_slots[store->free_count++] = HANDLE_SLOT(handle);
+    store->game_count--;
+  }
+  pthread_mutex_unlock(&store->mutex);
+}
+
+int store_game_count(game_store_t *store) {
+  pthread_mutex_lock(&store->mutex);
+  int count = store->game_count;
+  pthread_mutex_unlock(&store->mutex);
+  return count;
+}
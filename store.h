@@ -0,0 +1,45 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include <pthread.h>
+
+#include "game.h"
+
+#define STORE_BLOCK_SIZE 4096
+#define MAX_STORE_BLOCKS 4096
+#define INVALID_GAME_HANDLE UINT64_MAX
+
+typedef uint64_t game_handle_t;
+
+typedef struct stored_game {
+  position_snapshot_t position;
+  uint32_t generation;
+  uint16_t history_count;
+  uint64_t history[FIFTY_MOVE_PLIES];
+} stored_game_t;
+
+typedef struct game_store {
+  pthread_mutex_t mutex;
+  stored_game_t *blocks[MAX_STORE_BLOCKS];
+  int block_count;
+  uint32_t *free_slots;
+  int free_count;
+  int free_capacity;
+  int game_count;
+} game_store_t;
+
+/*
+ * The slot table, free list and generations are guarded by the mutex, so
+ * any mix of calls is safe across different handles. The stored game
+ * itself is copied outside the lock: load, save and remove of the same
+ * handle must be serialized by the caller.
+ */
+void init_game_store(game_store_t *store);
+void free_game_store(game_store_t *store);
+game_handle_t store_add_game(game_store_t *store, game_t *game);
+bool store_load_game(game_store_t *store, game_handle_t handle, game_t *game);
+bool store_save_game(game_store_t *store, game_handle_t handle, game_t *game);
+void store_remove_game(game_store_t *store, game_handle_t handle);
+int store_game_count(game_store_t *store);
+
+#endif
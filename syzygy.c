@@ -0,0 +1,1090 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "syzygy.h"
+
+/*
+ * Squares here follow the Syzygy convention (a1 = 0, b1 = 1, ..., h8 = 63)
+ * and pieces use the file encoding: 1..6 for white pawn..king, 9..14 for
+ * black. Board squares convert with TB_SQUARE.
+ */
+#define TB_SQUARE(square) ((square) ^ 7)
+#define TB_FILE(square) ((square) & 7)
+#define TB_RANK(square) ((square) >> 3)
+#define TB_PIECE(color, piece_type) ((piece_type) + 1 + 8 * (color))
+
+#define TB_HASH_BITS 13
+#define TB_HASH_SIZE (1 << TB_HASH_BITS)
+#define MAX_TB_TABLES 4096
+#define MAX_TB_PATH 4096
+
+#define TB_FLAG_STM 1
+#define TB_FLAG_MAPPED 2
+#define TB_FLAG_WIN_PLIES 4
+#define TB_FLAG_LOSS_PLIES 8
+#define TB_FLAG_WIDE 16
+#define TB_FLAG_SINGLE_VALUE 128
+
+#define TB_WDL 0
+#define TB_DTZ 1
+
+#define PROBE_FAIL 0
+#define PROBE_OK 1
+#define PROBE_CHANGE_STM 2
+#define PROBE_ZEROING_BEST_MOVE 3
+
+#define MAX_DTZ 1000
+
+static const uint8_t tb_magics[2][4] = { { 0x71, 0xE8, 0x23, 0x5D }, { 0xD7, 0x66, 0x0C, 0xA5 } };
+static const char tb_piece_chars[] = "PNBRQK";
+
+typedef struct sparse_entry {
+  uint8_t block[4];
+  uint8_t offset[2];
+} sparse_entry_t;
+
+typedef struct pairs_data {
+  uint8_t flags;
+  int max_sym_len;
+  int min_sym_len;
+  uint32_t block_count;
+  uint64_t block_size;
+  uint64_t span;
+  uint8_t *lowest_sym;
+  uint8_t *btree;
+  uint8_t *block_length;
+  uint32_t block_length_size;
+  sparse_entry_t *sparse_index;
+  uint64_t sparse_index_size;
+  uint8_t *data;
+  uint64_t *base64;
+  uint8_t *symlen;
+  int symbol_count;
+  uint8_t pieces[TB_MAX_PIECES];
+  uint64_t group_index[TB_MAX_PIECES + 1];
+  int group_length[TB_MAX_PIECES + 1];
+  uint16_t map_index[4];
+} pairs_data_t;
+
+typedef struct tb_table {
+  int type;
+  atomic_bool ready;
+  void *base_address;
+  size_t mapping;
+  uint8_t *map;
+  uint64_t key;
+  uint64_t key2;
+  int piece_count;
+  bool has_pawns;
+  bool has_unique_pieces;
+  uint8_t pawn_count[2];
+  pairs_data_t items[2][4];
+} tb_table_t;
+
+typedef struct tb_entry {
+  uint64_t key;
+  tb_table_t *wdl;
+  tb_table_t *dtz;
+} tb_entry_t;
+
+static char tb_paths[MAX_TB_PATH];
+static tb_entry_t tb_hash[TB_HASH_SIZE + 1];
+static tb_table_t *tb_tables;
+static int tb_table_count;
+static int tb_max_cardinality;
+static pthread_mutex_t tb_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int map_pawns[64];
+static int map_b1h1h7[64];
+static int map_a1d1d4[64];
+static int map_kk[10][64];
+static int binomial[6][64];
+static int lead_pawn_index[6][64];
+static int lead_pawns_size[6][4];
+
+static uint16_t read_le16(const void *address) {
+  uint16_t value;
+  memcpy(&value, address, sizeof(value));
+  return value;
+}
+
+static uint32_t read_le32(const void *address) {
+  uint32_t value;
+  memcpy(&value, address, sizeof(value));
+  return value;
+}
+
+static uint32_t read_be32(const void *address) {
+  return __builtin_bswap32(read_le32(address));
+}
+
+static uint64_t read_be64(const void *address) {
+  uint64_t value;
+  memcpy(&value, address, sizeof(value));
+  return __builtin_bswap64(value);
+}
+
+static int off_a1h8(int square) {
+  return TB_RANK(square) - TB_FILE(square);
+}
+
+static int edge_distance(int file) {
+  return (file < 7 - file) ? file : 7 - file;
+}
+
+static int sign_of(int value) {
+  return (value > 0) - (value < 0);
+}
+
+static int dtz_before_zeroing(int wdl) {
+  return wdl == TB_WIN ? 1 : wdl == TB_CURSED_WIN ? 101 : wdl == TB_BLESSED_LOSS ? -101 : wdl == TB_LOSS ? -1 : 0;
+}
+
+static int sym_left(pairs_data_t *d, int sym) {
+  uint8_t *lr = d->btree + 3 * sym;
+  return ((lr[1] & 0xF) << 8) | lr[0];
+}
+
+static int sym_right(pairs_data_t *d, int sym) {
+  uint8_t *lr = d->btree + 3 * sym;
+  return (lr[2] << 4) | (lr[1] >> 4);
+}
+
+static void init_indices(void) {
+  static bool initialized = false;
+  int code = 0;
+
+  if (initialized) {
+    return;
+  }
+  for (int square = 0; square < 64; square++) {
+    if (off_a1h8(square) < 0) {
+      map_b1h1h7[square] = code++;
+    }
+  }
+
+  int diagonal[4];
+  int diagonal_count = 0;
+  code = 0;
+  for (int square = 0; square <= 27; square++) {
+    if (off_a1h8(square) < 0 && TB_FILE(square) <= 3) {
+      map_a1d1d4[square] = code++;
+    } else if (!off_a1h8(square) && TB_FILE(square) <= 3) {
+      diagonal[diagonal_count++] = square;
+    }
+  }
+  for (int i = 0; i < diagonal_count; i++) {
+    map_a1d1d4[diagonal[i]] = code++;
+  }
+
+  int both_on_diagonal[64][2];
+  int both_count = 0;
+  code = 0;
+  for (int index = 0; index < 10; index++) {
+    for (int s1 = 0; s1 <= 27; s1++) {
+      if (map_a1d1d4[s1] != index || (!index && s1 != 1)) {
+        continue;
+      }
+      for (int s2 = 0; s2 < 64; s2++) {
+        int file_distance = abs(TB_FILE(s1) - TB_FILE(s2));
+        int rank_distance = abs(TB_RANK(s1) - TB_RANK(s2));
+        if (file_distance <= 1 && rank_distance <= 1) {
+          continue;
+        } else if (!off_a1h8(s1) && off_a1h8(s2) > 0) {
+          continue;
+        } else if (!off_a1h8(s1) && !off_a1h8(s2)) {
+          both_on_diagonal[both_count][0] = index;
+          both_on_diagonal[both_count++][1] = s2;
+        } else {
+          map_kk[index][s2] = code++;
+        }
+      }
+    }
+  }
+  for (int i = 0; i < both_count; i++) {
+    map_kk[both_on_diagonal[i][0]][both_on_diagonal[i][1]] = code++;
+  }
+
+  binomial[0][0] = 1;
+  for (int n = 1; n < 64; n++) {
+    for (int k = 0; k < 6 && k <= n; k++) {
+      binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+    }
+  }
+
+  int available_squares = 47;
+  for (int lead_pawns = 1; lead_pawns <= 5; lead_pawns++) {
+    for (int file = 0; file <= 3; file++) {
+      int index = 0;
+      for (int rank = 1; rank <= 6; rank++) {
+        int square = rank * 8 + file;
+        if (lead_pawns == 1) {
+          map_pawns[square] = available_squares--;
+          map_pawns[square ^ 7] = available_squares--;
+        }
+        lead_pawn_index[lead_pawns][square] = index;
+        index += binomial[lead_pawns - 1][map_pawns[square]];
+      }
+      lead_pawns_size[lead_pawns][file] = index;
+    }
+  }
+  initialized = true;
+}
+
+static uint32_t tb_bucket(uint64_t key) {
+  return (uint32_t) ((key * 0x9E3779B97F4A7C15ULL) >> (64 - TB_HASH_BITS));
+}
+
+static uint64_t swap_material_colors(uint64_t key) {
+  uint64_t mask = (1ULL << MATERIAL_SHIFT(BLACK, PAWN)) - 1;
+  return ((key & mask) << MATERIAL_SHIFT(BLACK, PAWN)) | (key >> MATERIAL_SHIFT(BLACK, PAWN));
+}
+
+static void insert_table(uint64_t key, tb_table_t *wdl, tb_table_t *dtz) {
+  uint32_t home = tb_bucket(key);
+  tb_entry_t entry = { key, wdl, dtz };
+
+  for (uint32_t bucket = home; bucket < TB_HASH_SIZE; bucket++) {
+    uint64_t other_key = tb_hash[bucket].key;
+    if (other_key == key || tb_hash[bucket].wdl == NULL) {
+      tb_hash[bucket] = entry;
+      return;
+    }
+    uint32_t other_home = tb_bucket(other_key);
+    if (other_home > home) {
+      tb_entry_t displaced = tb_hash[bucket];
+      tb_hash[bucket] = entry;
+      entry = displaced;
+      key = other_key;
+      home = other_home;
+    }
+  }
+}
+
+static tb_table_t *find_table(uint64_t key, int type) {
+  for (tb_entry_t *entry = &tb_hash[tb_bucket(key)]; ; entry++) {
+    if (entry->key == key || entry->wdl == NULL) {
+      return (type == TB_WDL) ? entry->wdl : entry->dtz;
+    }
+  }
+}
+
+static bool parse_table_name(const char *name, uint64_t *key, int *piece_count) {
+  color_t color = WHITE;
+  *key = 0;
+  *piece_count = 0;
+  if (name[0] != 'K') {
+    return false;
+  }
+  for (; *name && *name != '.'; name++) {
+    if (*name == 'v') {
+      if (color == BLACK || name[1] != 'K') {
+        return false;
+      }
+      color = BLACK;
+      continue;
+    }
+    const char *piece_char = strchr(tb_piece_chars, *name);
+    if (piece_char == NULL) {
+      return false;
+    }
+    *key += MATERIAL_UNIT(color, piece_char - tb_piece_chars);
+    (*piece_count)++;
+  }
+  return color == BLACK && strcmp(name, ".rtbw") == 0 && *piece_count <= TB_MAX_PIECES;
+}
+
+static void add_table(const char *name) {
+  uint64_t key;
+  int piece_count;
+
+  if (!parse_table_name(name, &key, &piece_count) || tb_table_count + 2 > MAX_TB_TABLES) {
+    return;
+  }
+  if (find_table(key, TB_WDL) != NULL) {
+    return;
+  }
+
+  tb_table_t *wdl = &tb_tables[tb_table_count++];
+  tb_table_t *dtz = &tb_tables[tb_table_count++];
+  memset(wdl, 0, sizeof(tb_table_t));
+  wdl->type = TB_WDL;
+  atomic_init(&wdl->ready, false);
+  wdl->key = key;
+  wdl->key2 = swap_material_colors(key);
+  wdl->piece_count = piece_count;
+  wdl->has_pawns = MATERIAL_COUNT(key, WHITE, PAWN) + MATERIAL_COUNT(key, BLACK, PAWN) > 0;
+  for (int color = WHITE; color <= BLACK; color++) {
+    for (int piece_type = PAWN; piece_type < KING; piece_type++) {
+      if (MATERIAL_COUNT(key, color, piece_type) == 1) {
+        wdl->has_unique_pieces = true;
+      }
+    }
+  }
+  int white_pawns = MATERIAL_COUNT(key, WHITE, PAWN);
+  int black_pawns = MATERIAL_COUNT(key, BLACK, PAWN);
+  bool white_leads = !black_pawns || (white_pawns && black_pawns >= white_pawns);
+  wdl->pawn_count[0] = white_leads ? white_pawns : black_pawns;
+  wdl->pawn_count[1] = white_leads ? black_pawns : white_pawns;
+
+  *dtz = *wdl;
+  dtz->type = TB_DTZ;
+  atomic_init(&dtz->ready, false);
+
+  insert_table(wdl->key, wdl, dtz);
+  insert_table(wdl->key2, wdl, dtz);
+  if (piece_count > tb_max_cardinality) {
+    tb_max_cardinality = piece_count;
+  }
+}
+
+int syzygy_init(const char *paths) {
+  char directories[MAX_TB_PATH];
+
+  syzygy_free();
+  if (paths == NULL || *paths == '\0' || strcmp(paths, "<empty>") == 0 || strlen(paths) >= MAX_TB_PATH) {
+    return 0;
+  }
+  init_indices();
+  strcpy(tb_paths, paths);
+  tb_tables = (tb_table_t*)calloc(MAX_TB_TABLES, sizeof(tb_table_t));
+
+  strcpy(directories, paths);
+  char *cursor;
+  for (char *directory = strtok_r(directories, ":", &cursor); directory; directory = strtok_r(NULL, ":", &cursor)) {
+    DIR *dir = opendir(directory);
+    struct dirent *file;
+    if (dir == NULL) {
+      continue;
+    }
+    while ((file = readdir(dir)) != NULL) {
+      add_table(file->d_name);
+    }
+    closedir(dir);
+  }
+  return tb_table_count / 2;
+}
+
+void syzygy_free(void) {
+  for (int i = 0; i < tb_table_count; i++) {
+    tb_table_t *table = &tb_tables[i];
+    if (table->base_address) {
+      munmap(table->base_address, table->mapping);
+    }
+    for (int side = 0; side < 2; side++) {
+      for (int file = 0; file < 4; file++) {
+        free(table->items[side][file].base64);
+        free(table->items[side][file].symlen);
+      }
+    }
+  }
+  free(tb_tables);
+  tb_tables = NULL;
+  tb_table_count = 0;
+  tb_max_cardinality = 0;
+  memset(tb_hash, 0, sizeof(tb_hash));
+}
+
+int syzygy_max_pieces(void) {
+  return tb_max_cardinality;
+}
+
+static pairs_data_t *get_pairs(tb_table_t *table, int stm, int file) {
+  return &table->items[(table->type == TB_WDL) ? stm % 2 : 0][table->has_pawns ? file : 0];
+}
+
+static int decompress_pairs(pairs_data_t *d, uint64_t index) {
+  if (d->flags & TB_FLAG_SINGLE_VALUE) {
+    return d->min_sym_len;
+  }
+
+  uint32_t k = (uint32_t) (index / d->span);
+  uint32_t block = read_le32(d->sparse_index[k].block);
+  int offset = read_le16(d->sparse_index[k].offset);
+  offset += (int) (index % d->span) - (int) (d->span / 2);
+
+  while (offset < 0) {
+    offset += read_le16(d->block_length + 2 * --block) + 1;
+  }
+  while (offset > read_le16(d->block_length + 2 * block)) {
+    offset -= read_le16(d->block_length + 2 * block++) + 1;
+  }
+
+  uint8_t *ptr = d->data + (uint64_t) block * d->block_size;
+  uint64_t buf64 = read_be64(ptr);
+  int buf64_size = 64;
+  int sym;
+  ptr += 8;
+
+  while (true) {
+    int length = 0;
+    while (buf64 < d->base64[length]) {
+      length++;
+    }
+    sym = (int) ((buf64 - d->base64[length]) >> (64 - length - d->min_sym_len));
+    sym += read_le16(d->lowest_sym + 2 * length);
+    if (offset < d->symlen[sym] + 1) {
+      break;
+    }
+    offset -= d->symlen[sym] + 1;
+    length += d->min_sym_len;
+    buf64 <<= length;
+    buf64_size -= length;
+    if (buf64_size <= 32) {
+      buf64_size += 32;
+      buf64 |= (uint64_t) read_be32(ptr) << (64 - buf64_size);
+      ptr += 4;
+    }
+  }
+
+  while (d->symlen[sym]) {
+    int left = sym_left(d, sym);
+    if (offset < d->symlen[left] + 1) {
+      sym = left;
+    } else {
+      offset -= d->symlen[left] + 1;
+      sym = sym_right(d, sym);
+    }
+  }
+  return sym_left(d, sym);
+}
+
+static int map_score(tb_table_t *table, int file, int value, int wdl) {
+  static const int wdl_map[] = { 1, 3, 0, 2, 0 };
+
+  if (table->type == TB_WDL) {
+    return value - 2;
+  }
+  pairs_data_t *d = get_pairs(table, 0, file);
+  if (d->flags & TB_FLAG_MAPPED) {
+    if (d->flags & TB_FLAG_WIDE) {
+      value = read_le16(table->map + 2 * (d->map_index[wdl_map[wdl + 2]] + value));
+    } else {
+      value = table->map[d->map_index[wdl_map[wdl + 2]] + value];
+    }
+  }
+  if ((wdl == TB_WIN && !(d->flags & TB_FLAG_WIN_PLIES)) ||
+      (wdl == TB_LOSS && !(d->flags & TB_FLAG_LOSS_PLIES)) ||
+      wdl == TB_CURSED_WIN || wdl == TB_BLESSED_LOSS) {
+    value *= 2;
+  }
+  return value + 1;
+}
+
+static void sort_squares(int *squares, int count, const int *order) {
+  for (int i = 1; i < count; i++) {
+    int square = squares[i];
+    int j = i - 1;
+    while (j >= 0 && (order ? order[squares[j]] > order[square] : squares[j] > square)) {
+      squares[j + 1] = squares[j];
+      j--;
+    }
+    squares[j + 1] = square;
+  }
+}
+
+static int probe_table_index(game_t *game, tb_table_t *table, int wdl, int *result) {
+  board_t *board = &game->position;
+  int squares[TB_MAX_PIECES];
+  int pieces[TB_MAX_PIECES];
+  int size = 0;
+  int lead_pawns_count = 0;
+  int file = 0;
+  bitboard_t lead_pawns = 0;
+  uint64_t index;
+
+  bool symmetric_black_to_move = table->key == table->key2 && game->color_to_move == BLACK;
+  bool black_stronger = board->material_key != table->key;
+  bool flip = symmetric_black_to_move || black_stronger;
+  int flip_color = flip * 8;
+  int flip_squares = flip * 56;
+  int stm = flip ^ (game->color_to_move == BLACK);
+
+  if (table->has_pawns) {
+    int lead_piece = get_pairs(table, 0, 0)->pieces[0] ^ flip_color;
+    bitboard_t bb = lead_pawns = board->pieces[lead_piece >> 3][PAWN];
+    while (bb) {
+      squares[size++] = TB_SQUARE(pop_lsb(&bb)) ^ flip_squares;
+    }
+    lead_pawns_count = size;
+    int lead = 0;
+    for (int i = 1; i < lead_pawns_count; i++) {
+      if (map_pawns[squares[i]] > map_pawns[squares[lead]]) {
+        lead = i;
+      }
+    }
+    int swap = squares[0];
+    squares[0] = squares[lead];
+    squares[lead] = swap;
+    file = edge_distance(TB_FILE(squares[0]));
+  }
+
+  if (table->type == TB_DTZ) {
+    int flags = get_pairs(table, stm, file)->flags;
+    if ((flags & TB_FLAG_STM) != stm && !(table->key == table->key2 && !table->has_pawns)) {
+      *result = PROBE_CHANGE_STM;
+      return 0;
+    }
+  }
+
+  for (int color = WHITE; color <= BLACK; color++) {
+    for (int piece_type = PAWN; piece_type <= KING; piece_type++) {
+      bitboard_t bb = board->pieces[color][piece_type] & ~lead_pawns;
+      while (bb) {
+        squares[size] = TB_SQUARE(pop_lsb(&bb)) ^ flip_squares;
+        pieces[size++] = TB_PIECE(color, piece_type) ^ flip_color;
+      }
+    }
+  }
+
+  pairs_data_t *d = get_pairs(table, stm, file);
+  for (int i = lead_pawns_count; i < size - 1; i++) {
+    for (int j = i + 1; j < size; j++) {
+      if (d->pieces[i] == pieces[j]) {
+        int swap = pieces[i];
+        pieces[i] = pieces[j];
+        pieces[j] = swap;
+        swap = squares[i];
+        squares[i] = squares[j];
+        squares[j] = swap;
+        break;
+      }
+    }
+  }
+
+  if (TB_FILE(squares[0]) > 3) {
+    for (int i = 0; i < size; i++) {
+      squares[i] ^= 7;
+    }
+  }
+
+  if (table->has_pawns) {
+    index = lead_pawn_index[lead_pawns_count][squares[0]];
+    sort_squares(squares + 1, lead_pawns_count - 1, map_pawns);
+    for (int i = 1; i < lead_pawns_count; i++) {
+      index += binomial[i][map_pawns[squares[i]]];
+    }
+  } else {
+    if (TB_RANK(squares[0]) > 3) {
+      for (int i = 0; i < size; i++) {
+        squares[i] ^= 56;
+      }
+    }
+    for (int i = 0; i < d->group_length[0]; i++) {
+      if (!off_a1h8(squares[i])) {
+        continue;
+      }
+      if (off_a1h8(squares[i]) > 0) {
+        for (int j = i; j < size; j++) {
+          squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+        }
+      }
+      break;
+    }
+
+    if (table->has_unique_pieces) {
+      int adjust1 = squares[1] > squares[0];
+      int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+      if (off_a1h8(squares[0])) {
+        index = ((uint64_t) map_a1d1d4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+      } else if (off_a1h8(squares[1])) {
+        index = (6 * 63 + TB_RANK(squares[0]) * 28 + map_b1h1h7[squares[1]]) * 62 + squares[2] - adjust2;
+      } else if (off_a1h8(squares[2])) {
+        index = 6 * 63 * 62 + 4 * 28 * 62 + TB_RANK(squares[0]) * 7 * 28 +
+                (TB_RANK(squares[1]) - adjust1) * 28 + map_b1h1h7[squares[2]];
+      } else {
+        index = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + TB_RANK(squares[0]) * 7 * 6 +
+                (TB_RANK(squares[1]) - adjust1) * 6 + (TB_RANK(squares[2]) - adjust2);
+      }
+    } else {
+      index = map_kk[map_a1d1d4[squares[0]]][squares[1]];
+    }
+  }
+
+  index *= d->group_index[0];
+  int *group_squares = squares + d->group_length[0];
+  bool remaining_pawns = table->has_pawns && table->pawn_count[1];
+  for (int next = 1; d->group_length[next]; next++) {
+    uint64_t n = 0;
+    sort_squares(group_squares, d->group_length[next], NULL);
+    for (int i = 0; i < d->group_length[next]; i++) {
+      int adjust = 0;
+      for (int *square = squares; square < group_squares; square++) {
+        adjust += group_squares[i] > *square;
+      }
+      n += binomial[i + 1][group_squares[i] - adjust - 8 * remaining_pawns];
+    }
+    remaining_pawns = false;
+    index += n * d->group_index[next];
+    group_squares += d->group_length[next];
+  }
+
+  return map_score(table, file, decompress_pairs(d, index), wdl);
+}
+
+static void set_groups(tb_table_t *table, pairs_data_t *d, int *order, int file) {
+  int n = 0;
+  int first_length = table->has_pawns ? 0 : table->has_unique_pieces ? 3 : 2;
+
+  d->group_length[n] = 1;
+  for (int i = 1; i < table->piece_count; i++) {
+    if (--first_length > 0 || d->pieces[i] == d->pieces[i - 1]) {
+      d->group_length[n]++;
+    } else {
+      d->group_length[++n] = 1;
+    }
+  }
+  d->group_length[++n] = 0;
+
+  bool both_pawns = table->has_pawns && table->pawn_count[1];
+  int next = both_pawns ? 2 : 1;
+  int free_squares = 64 - d->group_length[0] - (both_pawns ? d->group_length[1] : 0);
+  uint64_t index = 1;
+
+  for (int k = 0; next < n || k == order[0] || k == order[1]; k++) {
+    if (k == order[0]) {
+      d->group_index[0] = index;
+      index *= table->has_pawns ? lead_pawns_size[d->group_length[0]][file] : table->has_unique_pieces ? 31332 : 462;
+    } else if (k == order[1]) {
+      d->group_index[1] = index;
+      index *= binomial[d->group_length[1]][48 - d->group_length[0]];
+    } else {
+      d->group_index[next] = index;
+      index *= binomial[d->group_length[next]][free_squares];
+      free_squares -= d->group_length[next++];
+    }
+  }
+  d->group_index[n] = index;
+}
+
+static int set_symlen(pairs_data_t *d, int sym, bool *visited) {
+  visited[sym] = true;
+  int right = sym_right(d, sym);
+  if (right == 0xFFF) {
+    return 0;
+  }
+  int left = sym_left(d, sym);
+  if (!visited[left]) {
+    d->symlen[left] = (uint8_t) set_symlen(d, left, visited);
+  }
+  if (!visited[right]) {
+    d->symlen[right] = (uint8_t) set_symlen(d, right, visited);
+  }
+  return d->symlen[left] + d->symlen[right] + 1;
+}
+
+static uint8_t *set_sizes(pairs_data_t *d, uint8_t *data) {
+  d->flags = *data++;
+  if (d->flags & TB_FLAG_SINGLE_VALUE) {
+    d->block_count = 0;
+    d->span = 0;
+    d->block_length_size = 0;
+    d->sparse_index_size = 0;
+    d->min_sym_len = *data++;
+    return data;
+  }
+
+  int group_count = 0;
+  while (group_count < TB_MAX_PIECES && d->group_length[group_count]) {
+    group_count++;
+  }
+  uint64_t tb_size = d->group_index[group_count];
+
+  d->block_size = 1ULL << *data++;
+  d->span = 1ULL << *data++;
+  d->sparse_index_size = (tb_size + d->span - 1) / d->span;
+  int padding = *data++;
+  d->block_count = read_le32(data);
+  data += 4;
+  d->block_length_size = d->block_count + padding;
+  d->max_sym_len = *data++;
+  d->min_sym_len = *data++;
+  d->lowest_sym = data;
+
+  int base_count = d->max_sym_len - d->min_sym_len + 1;
+  d->base64 = (uint64_t*)calloc(base_count, sizeof(uint64_t));
+  for (int i = base_count - 2; i >= 0; i--) {
+    d->base64[i] = (d->base64[i + 1] + read_le16(d->lowest_sym + 2 * i) - read_le16(d->lowest_sym + 2 * (i + 1))) / 2;
+  }
+  for (int i = 0; i < base_count; i++) {
+    d->base64[i] <<= 64 - i - d->min_sym_len;
+  }
+
+  data += base_count * 2;
+  d->symbol_count = read_le16(data);
+  data += 2;
+  d->btree = data;
+  d->symlen = (uint8_t*)calloc(d->symbol_count, 1);
+
+  bool *visited = (bool*)calloc(d->symbol_count, sizeof(bool));
+  for (int sym = 0; sym < d->symbol_count; sym++) {
+    if (!visited[sym]) {
+      d->symlen[sym] = (uint8_t) set_symlen(d, sym, visited);
+    }
+  }
+  free(visited);
+  return data + d->symbol_count * 3 + (d->symbol_count & 1);
+}
+
+static uint8_t *set_dtz_map(tb_table_t *table, uint8_t *data, int max_file) {
+  if (table->type == TB_WDL) {
+    return data;
+  }
+  table->map = data;
+  for (int file = 0; file <= max_file; file++) {
+    pairs_data_t *d = get_pairs(table, 0, file);
+    if (!(d->flags & TB_FLAG_MAPPED)) {
+      continue;
+    }
+    if (d->flags & TB_FLAG_WIDE) {
+      data += (uintptr_t) data & 1;
+      for (int i = 0; i < 4; i++) {
+        d->map_index[i] = (uint16_t) ((data - table->map) / 2 + 1);
+        data += 2 * read_le16(data) + 2;
+      }
+    } else {
+      for (int i = 0; i < 4; i++) {
+        d->map_index[i] = (uint16_t) (data - table->map + 1);
+        data += *data + 1;
+      }
+    }
+  }
+  return data + ((uintptr_t) data & 1);
+}
+
+static void set_table(tb_table_t *table, uint8_t *data) {
+  int sides = (table->type == TB_WDL && table->key != table->key2) ? 2 : 1;
+  int max_file = table->has_pawns ? 3 : 0;
+  bool both_pawns = table->has_pawns && table->pawn_count[1];
+
+  data++;
+  for (int file = 0; file <= max_file; file++) {
+    int order[2][2] = {
+      { *data & 0xF, both_pawns ? *(data + 1) & 0xF : 0xF },
+      { *data >> 4, both_pawns ? *(data + 1) >> 4 : 0xF }
+    };
+    data += 1 + both_pawns;
+    for (int k = 0; k < table->piece_count; k++, data++) {
+      for (int i = 0; i < sides; i++) {
+        get_pairs(table, i, file)->pieces[k] = i ? *data >> 4 : *data & 0xF;
+      }
+    }
+    for (int i = 0; i < sides; i++) {
+      set_groups(table, get_pairs(table, i, file), order[i], file);
+    }
+  }
+  data += (uintptr_t) data & 1;
+
+  for (int file = 0; file <= max_file; file++) {
+    for (int i = 0; i < sides; i++) {
+      data = set_sizes(get_pairs(table, i, file), data);
+    }
+  }
+  data = set_dtz_map(table, data, max_file);
+  for (int file = 0; file <= max_file; file++) {
+    for (int i = 0; i < sides; i++) {
+      pairs_data_t *d = get_pairs(table, i, file);
+      d->sparse_index = (sparse_entry_t*) data;
+      data += d->sparse_index_size * sizeof(sparse_entry_t);
+    }
+  }
+  for (int file = 0; file <= max_file; file++) {
+    for (int i = 0; i < sides; i++) {
+      pairs_data_t *d = get_pairs(table, i, file);
+      d->block_length = data;
+      data += d->block_length_size * 2;
+    }
+  }
+  for (int file = 0; file <= max_file; file++) {
+    for (int i = 0; i < sides; i++) {
+      pairs_data_t *d = get_pairs(table, i, file);
+      data = (uint8_t*) (((uintptr_t) data + 0x3F) & ~(uintptr_t) 0x3F);
+      d->data = data;
+      data += (uint64_t) d->block_count * d->block_size;
+    }
+  }
+}
+
+static void table_file_name(tb_table_t *table, board_t *board, char *name) {
+  char sides[2][TB_MAX_PIECES + 1];
+  for (int color = WHITE; color <= BLACK; color++) {
+    char *cursor = sides[color];
+    for (int piece_type = KING; piece_type >= PAWN; piece_type--) {
+      for (int i = pop_count(board->pieces[color][piece_type]); i > 0; i--) {
+        *cursor++ = tb_piece_chars[piece_type];
+      }
+    }
+    *cursor = '\0';
+  }
+  bool white_first = table->key == board->material_key;
+  sprintf(name, "%sv%s%s", sides[white_first ? WHITE : BLACK], sides[white_first ? BLACK : WHITE],
+          table->type == TB_WDL ? ".rtbw" : ".rtbz");
+}
+
+static uint8_t *map_file(tb_table_t *table, const char *name) {
+  char directories[MAX_TB_PATH];
+  char path[MAX_TB_PATH + 32];
+  char *cursor;
+  int fd = -1;
+
+  strcpy(directories, tb_paths);
+  for (char *directory = strtok_r(directories, ":", &cursor); directory && fd < 0; directory = strtok_r(NULL, ":", &cursor)) {
+    snprintf(path, sizeof(path), "%s/%s", directory, name);
+    fd = open(path, O_RDONLY);
+  }
+  if (fd < 0) {
+    return NULL;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size % 64 != 16) {
+    close(fd);
+    return NULL;
+  }
+  void *base_address = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base_address == MAP_FAILED) {
+    return NULL;
+  }
+  madvise(base_address, file_stat.st_size, MADV_RANDOM);
+  if (memcmp(base_address, tb_magics[table->type], 4) != 0) {
+    munmap(base_address, file_stat.st_size);
+    return NULL;
+  }
+  table->base_address = base_address;
+  table->mapping = file_stat.st_size;
+  return (uint8_t*) base_address + 4;
+}
+
+static bool ensure_mapped(tb_table_t *table, board_t *board) {
+  char name[32];
+
+  if (atomic_load_explicit(&table->ready, memory_order_acquire)) {
+    return table->base_address != NULL;
+  }
+  pthread_mutex_lock(&tb_mutex);
+  if (!atomic_load_explicit(&table->ready, memory_order_relaxed)) {
+    table_file_name(table, board, name);
+    uint8_t *data = map_file(table, name);
+    if (data) {
+      set_table(table, data);
+    }
+    atomic_store_explicit(&table->ready, true, memory_order_release);
+  }
+  pthread_mutex_unlock(&tb_mutex);
+  return table->base_address != NULL;
+}
+
+static int probe_table(game_t *game, int type, int wdl, int *result) {
+  if (piece_count(&game->position) == 2) {
+    return TB_DRAW;
+  }
+  tb_table_t *table = find_table(game->position.material_key, type);
+  if (table == NULL || !ensure_mapped(table, &game->position)) {
+    *result = PROBE_FAIL;
+    return 0;
+  }
+  return probe_table_index(game, table, wdl, result);
+}
+
+static bool is_zeroing_move(game_t *game, move_t move) {
+  return is_capture_move(game, move) || (game->position.pieces[game->color_to_move][PAWN] & SQUARE_BB(MOVE_START(move)));
+}
+
+static int probe_search(game_t *game, int *result, bool check_zeroing_moves) {
+  move_list_t move_list;
+  int best_value = TB_LOSS;
+  int value;
+  int move_count = 0;
+
+  init_move_list(&move_list);
+  calculate_legal_moves(game, &move_list);
+  for (int i = 0; i < move_list.count; i++) {
+    move_t move = move_list.entries[i];
+    if (!is_capture_move(game, move) && (!check_zeroing_moves || !is_zeroing_move(game, move))) {
+      continue;
+    }
+    move_count++;
+    make_move(game, move);
+    value = -probe_search(game, result, false);
+    unmake_move(game);
+    if (*result == PROBE_FAIL) {
+      return TB_DRAW;
+    }
+    if (value > best_value) {
+      best_value = value;
+      if (value >= TB_WIN) {
+        *result = PROBE_ZEROING_BEST_MOVE;
+        return value;
+      }
+    }
+  }
+
+  bool no_more_moves = move_count && move_count == move_list.count;
+  if (no_more_moves) {
+    value = best_value;
+  } else {
+    value = probe_table(game, TB_WDL, TB_DRAW, result);
+    if (*result == PROBE_FAIL) {
+      return TB_DRAW;
+    }
+  }
+
+  if (best_value >= value) {
+    *result = (best_value > TB_DRAW || no_more_moves) ? PROBE_ZEROING_BEST_MOVE : PROBE_OK;
+    return best_value;
+  }
+  *result = PROBE_OK;
+  return value;
+}
+
+static bool can_probe(game_t *game) {
+  return tb_max_cardinality > 0 && game->castling_rights == 0 && piece_count(&game->position) <= tb_max_cardinality;
+}
+
+bool syzygy_probe_wdl(game_t *game, int *wdl) {
+  int result = PROBE_OK;
+  if (!can_probe(game)) {
+    return false;
+  }
+  *wdl = probe_search(game, &result, false);
+  return result != PROBE_FAIL;
+}
+
+static int probe_dtz(game_t *game, int *result) {
+  *result = PROBE_OK;
+  int wdl = probe_search(game, result, true);
+  if (*result == PROBE_FAIL || wdl == TB_DRAW) {
+    return 0;
+  }
+  if (*result == PROBE_ZEROING_BEST_MOVE) {
+    return dtz_before_zeroing(wdl);
+  }
+
+  int dtz = probe_table(game, TB_DTZ, wdl, result);
+  if (*result == PROBE_FAIL) {
+    return 0;
+  }
+  if (*result != PROBE_CHANGE_STM) {
+    return (dtz + 100 * (wdl == TB_BLESSED_LOSS || wdl == TB_CURSED_WIN)) * sign_of(wdl);
+  }
+
+  move_list_t move_list;
+  int min_dtz = INT_MAX;
+  init_move_list(&move_list);
+  calculate_legal_moves(game, &move_list);
+  for (int i = 0; i < move_list.count; i++) {
+    move_t move = move_list.entries[i];
+    bool zeroing = is_zeroing_move(game, move);
+    make_move(game, move);
+    if (zeroing) {
+      dtz = -dtz_before_zeroing(probe_search(game, result, false));
+    } else {
+      dtz = -probe_dtz(game, result);
+    }
+    if (dtz == 1 && is_in_check(game)) {
+      move_list_t replies;
+      init_move_list(&replies);
+      calculate_legal_moves(game, &replies);
+      if (replies.count == 0) {
+        min_dtz = 1;
+      }
+    }
+    if (!zeroing) {
+      dtz += sign_of(dtz);
+    }
+    if (dtz < min_dtz && sign_of(dtz) == sign_of(wdl)) {
+      min_dtz = dtz;
+    }
+    unmake_move(game);
+    if (*result == PROBE_FAIL) {
+      return 0;
+    }
+  }
+  return (min_dtz == INT_MAX) ? -1 : min_dtz;
+}
+
+bool syzygy_probe_dtz(game_t *game, int *dtz) {
+  int result = PROBE_OK;
+  if (!can_probe(game)) {
+    return false;
+  }
+  *dtz = probe_dtz(game, &result);
+  return result != PROBE_FAIL;
+}
+
+static int root_wdl(int dtz, int halfmove_clock) {
+  return (dtz > 0) ? ((dtz + halfmove_clock <= 99) ? TB_WIN : TB_CURSED_WIN)
+       : (dtz < 0) ? ((-dtz * 2 + halfmove_clock < 100) ? TB_LOSS : TB_BLESSED_LOSS)
+       : TB_DRAW;
+}
+
+bool syzygy_probe_root(game_t *game, move_list_t *root_moves, int *wdl) {
+  move_list_t move_list;
+  int ranks[MAX_MOVES];
+  int wdls[MAX_MOVES] = { 0 };
+  int result = PROBE_OK;
+
+  if (!can_probe(game)) {
+    return false;
+  }
+  init_move_list(&move_list);
+  calculate_legal_moves(game, &move_list);
+  if (move_list.count == 0) {
+    return false;
+  }
+  for (int i = 0; i < move_list.count; i++) {
+    move_t move = move_list.entries[i];
+    int dtz;
+    make_move(game, move);
+    if (game->halfmove_clock == 0) {
+      dtz = dtz_before_zeroing(-probe_search(game, &result, false));
+    } else if (count_repetitions(game) > 0) {
+      dtz = 0;
+    } else {
+      dtz = -probe_dtz(game, &result);
+      dtz = (dtz > 0) ? dtz + 1 : (dtz < 0) ? dtz - 1 : 0;
+    }
+    if (dtz == 2 && is_in_check(game)) {
+      move_list_t replies;
+      init_move_list(&replies);
+      calculate_legal_moves(game, &replies);
+      if (replies.count == 0) {
+        dtz = 1;
+      }
+    }
+    unmake_move(game);
+    if (result == PROBE_FAIL) {
+      return false;
+    }
+
+    int halfmove_clock = game->halfmove_clock;
+    int rank = (dtz > 0) ? ((dtz + halfmove_clock <= 99) ? MAX_DTZ * 2 - dtz : MAX_DTZ - dtz)
+             : (dtz < 0) ? ((-dtz * 2 + halfmove_clock < 100) ? -MAX_DTZ * 2 - dtz : -MAX_DTZ - dtz)
+             : 0;
+    int j = i;
+    for (; j > 0 && ranks[j - 1] < rank; j--) {
+      move_list.entries[j] = move_list.entries[j - 1];
+      ranks[j] = ranks[j - 1];
+      wdls[j] = wdls[j - 1];
+    }
+    move_list.entries[j] = move;
+    ranks[j] = rank;
+    wdls[j] = root_wdl(dtz, halfmove_clock);
+  }
+
+  *wdl = wdls[0];
+  init_move_list(root_moves);
+  for (int i = 0; i < move_list.count && wdls[i] == *wdl; i++) {
+    add_to_move_list(root_moves, move_list.entries[i]);
+  }
+  return true;
+}
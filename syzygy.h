@@ -0,0 +1,23 @@
+#ifndef SYZYGY_H
+#define SYZYGY_H
+
+#include <stdbool.h>
+
+#include "game.h"
+
+#define TB_LOSS -2
+#define TB_BLESSED_LOSS -1
+#define TB_DRAW 0
+#define TB_CURSED_WIN 1
+#define TB_WIN 2
+
+#define TB_MAX_PIECES 7
+
+int syzygy_init(const char *paths);
+void syzygy_free(void);
+int syzygy_max_pieces(void);
+bool syzygy_probe_wdl(game_t *game, int *wdl);
+bool syzygy_probe_dtz(game_t *game, int *dtz);
+bool syzygy_probe_root(game_t *game, move_list_t *root_moves, int *wdl);
+
+#endif
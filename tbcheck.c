@@ -0,0 +1,207 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "syzygy.h"
+
+#define ANY_DTZ INT_MIN
+#define DEFAULT_WALK_DEPTH 3
+#define MAX_LINE_LENGTH 1024
+
+typedef struct tb_case {
+  const char *fen;
+  int wdl;
+  int dtz;
+} tb_case_t;
+
+typedef struct tb_check {
+  int depth;
+  unsigned long long positions;
+  int failures;
+} tb_check_t;
+
+static const tb_case_t tb_suite[] = {
+  { "4k3/8/8/8/8/8/8/4KQ2 w - - 0 1", TB_WIN, ANY_DTZ },
+  { "4k3/8/8/8/8/8/8/4KQ2 b - - 0 1", TB_LOSS, ANY_DTZ },
+  { "7k/8/6K1/8/8/8/8/1Q6 w - - 0 1", TB_WIN, 1 },
+  { "4k3/8/8/8/8/8/8/R3K3 w - - 0 1", TB_WIN, ANY_DTZ },
+  { "8/8/8/8/8/8/8/KN5k w - - 0 1", TB_DRAW, 0 },
+  { "8/8/8/8/8/8/8/KB5k b - - 0 1", TB_DRAW, 0 },
+  { "k7/8/8/8/8/8/P7/K7 w - - 0 1", TB_DRAW, 0 },
+  { "8/8/8/8/8/8/8/KBN4k w - - 0 1", TB_WIN, ANY_DTZ }
+};
+
+static int sign_of(int value) {
+  return (value > 0) - (value < 0);
+}
+
+static void report(game_t *game, const char *message, int expected, int actual) {
+  char fen[MAX_FEN_LENGTH];
+  save_fen(game, fen);
+  printf("FAILED: %s %s: expected %d, got %d\n", fen, message, expected, actual);
+}
+
+/*
+ * A position is won (ignoring the fifty-move rule) exactly when some move
+ * leads to a lost position, and a DTZ of d > 1 must be reachable through a
+ * non-zeroing move to a position with DTZ -(d - 1).
+ */
+static void check_position(game_t *game, tb_check_t *check) {
+  move_list_t move_list;
+  int wdl;
+  int dtz;
+
+  init_move_list(&move_list);
+  calculate_legal_moves(game, &move_list);
+  if (move_list.count == 0 || !syzygy_probe_wdl(game, &wdl) || !syzygy_probe_dtz(game, &dtz)) {
+    return;
+  }
+  check->positions++;
+
+  int best = -2;
+  bool dtz_reached = dtz <= 1 || dtz > 100;
+  for (int i = 0; i < move_list.count; i++) {
+    move_t move = move_list.entries[i];
+    int child_wdl;
+    int child_dtz;
+    make_move(game, move);
+    if (syzygy_probe_wdl(game, &child_wdl)) {
+      if (-sign_of(child_wdl) > best) {
+        best = -sign_of(child_wdl);
+      }
+      if (!dtz_reached && game->halfmove_clock != 0 && syzygy_probe_dtz(game, &child_dtz) && child_dtz == -(dtz - 1)) {
+        dtz_reached = true;
+      }
+    }
+    unmake_move(game);
+  }
+  if (best != sign_of(wdl)) {
+    report(game, "wdl sign against successors", best, sign_of(wdl));
+    check->failures++;
+  }
+  if (sign_of(dtz) != sign_of(wdl)) {
+    report(game, "dtz sign against wdl", sign_of(wdl), sign_of(dtz));
+    check->failures++;
+  }
+  if (!dtz_reached) {
+    report(game, "dtz not reached by any successor", dtz - 1, 0);
+    check->failures++;
+  }
+}
+
+static void walk(game_t *game, int depth, tb_check_t *check) {
+  move_list_t move_list;
+
+  if (piece_count(&game->position) > syzygy_max_pieces()) {
+    return;
+  }
+  check_position(game, check);
+  if (depth == 0) {
+    return;
+  }
+  init_move_list(&move_list);
+  calculate_legal_moves(game, &move_list);
+  for (int i = 0; i < move_list.count; i++) {
+    make_move(game, move_list.entries[i]);
+    walk(game, depth - 1, check);
+    unmake_move(game);
+  }
+}
+
+static void check_case(game_t *game, const char *fen, int expected_wdl, int expected_dtz, tb_check_t *check) {
+  int wdl;
+  int dtz;
+
+  if (!load_fen(game, fen)) {
+    printf("FAILED: invalid fen %s\n", fen);
+    check->failures++;
+    return;
+  }
+  if (!syzygy_probe_wdl(game, &wdl) || !syzygy_probe_dtz(game, &dtz)) {
+    printf("FAILED: %s: probe failed\n", fen);
+    check->failures++;
+    return;
+  }
+  if (wdl != expected_wdl) {
+    report(game, "wdl", expected_wdl, wdl);
+    check->failures++;
+  }
+  if (expected_dtz != ANY_DTZ && dtz != expected_dtz) {
+    report(game, "dtz", expected_dtz, dtz);
+    check->failures++;
+  }
+  walk(game, check->depth, check);
+}
+
+static void check_file(game_t *game, const char *path, tb_check_t *check) {
+  FILE *file = fopen(path, "r");
+  char line[MAX_LINE_LENGTH];
+
+  if (file == NULL) {
+    fprintf(stderr, "cannot open %s\n", path);
+    check->failures++;
+    return;
+  }
+  while (fgets(line, sizeof(line), file)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#') {
+      continue;
+    }
+    int wdl = TB_DRAW;
+    int dtz = ANY_DTZ;
+    char *annotation = strchr(line, ';');
+    for (char *cursor = annotation; cursor; cursor = strchr(cursor + 1, ';')) {
+      sscanf(cursor, ";wdl %d", &wdl);
+      sscanf(cursor, ";dtz %d", &dtz);
+    }
+    if (annotation) {
+      *annotation = '\0';
+    }
+    check_case(game, line, wdl, dtz, check);
+  }
+  fclose(file);
+}
+
+int main(int argc, char **argv) {
+  const char *paths = NULL;
+  const char *file = NULL;
+  tb_check_t check = { DEFAULT_WALK_DEPTH, 0, 0 };
+  game_t game;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+      file = argv[++i];
+    } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+      check.depth = atoi(argv[++i]);
+    } else if (paths == NULL && argv[i][0] != '-') {
+      paths = argv[i];
+    } else {
+      paths = NULL;
+      break;
+    }
+  }
+  if (paths == NULL) {
+    fprintf(stderr, "usage: %s SYZYGY_PATH [--file EPD] [--depth PLIES]\n", argv[0]);
+    return 2;
+  }
+  int tables = syzygy_init(paths);
+  printf("found %d tablebases, up to %d pieces\n", tables, syzygy_max_pieces());
+  if (syzygy_max_pieces() < 3) {
+    return 2;
+  }
+
+  init_game(&game);
+  if (file) {
+    check_file(&game, file, &check);
+  } else {
+    for (size_t i = 0; i < sizeof(tb_suite) / sizeof(tb_suite[0]); i++) {
+      check_case(&game, tb_suite[i].fen, tb_suite[i].wdl, tb_suite[i].dtz, &check);
+    }
+  }
+  free_game(&game);
+  syzygy_free();
+  printf("%llu position(s) walked, %d failure(s)\n", check.positions, check.failures);
+  return check.failures != 0;
+}
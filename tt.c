@@ -0,0 +1,125 @@
+#include <string.h>
+
+#include "stats.h"
+#include "tt.h"
+
+#define GENERATION_MASK 63
+
+transposition_table_t tt = { NULL, 0, 0 };
+
+static uint64_t pack_data(move_t move, int score, int eval, int depth, int bound, int generation) {
+  return (uint64_t) move |
+         ((uint64_t) (uint16_t) score << 16) |
+         ((uint64_t) (uint16_t) eval << 32) |
+         ((uint64_t) (uint8_t) depth << 48) |
+         ((uint64_t) bound << 56) |
+         ((uint64_t) generation << 58);
+}
+
+static int data_depth(uint64_t data) {
+  return (uint8_t) (data >> 48);
+}
+
+static int data_generation(uint64_t data) {
+  return (int) (data >> 58);
+}
+
+void tt_resize(transposition_table_t *table, size_t megabytes) {
+  size_t cluster_count = 1;
+  while (cluster_count * 2 * sizeof(tt_cluster_t) <= megabytes * 1024 * 1024) {
+    cluster_count *= 2;
+  }
+  free(table->clusters);
+  table->clusters = (tt_cluster_t*)aligned_alloc(64, cluster_count * sizeof(tt_cluster_t));
+  table->mask = cluster_count - 1;
+  tt_clear(table);
+}
+
+void tt_free(transposition_table_t *table) {
+  free(table->clusters);
+  table->clusters = NULL;
+  table->mask = 0;
+  table->generation = 0;
+}
+
+void tt_clear(transposition_table_t *table) {
+  if (table->clusters) {
+    memset(table->clusters, 0, (table->mask + 1) * sizeof(tt_cluster_t));
+  }
+  table->generation = 0;
+}
+
+void tt_new_search(transposition_table_t *table) {
+  if (table->clusters == NULL) {
+    tt_resize(table, DEFAULT_TT_SIZE_MB);
+  }
+  table->generation = (table->generation + 1) & GENERATION_MASK;
+}
+
+bool tt_probe(transposition_table_t *table, uint64_t key, tt_data_t *data) {
+  tt_cluster_t *cluster = &table->clusters[key & table->mask];
+  STATS_INC(tt_probes);
+  for (int i = 0; i < TT_CLUSTER_SIZE; i++) {
+    uint64_t checksum = atomic_load_explicit(&cluster->entries[i].checksum, memory_order_relaxed);
+    uint64_t entry_data = atomic_load_explicit(&cluster->entries[i].data, memory_order_relaxed);
+    if ((checksum ^ entry_data) == key && entry_data != 0) {
+      data->move = (move_t) entry_data;
+      data->score = (int16_t) (entry_data >> 16);
+      data->eval = (int16_t) (entry_data >> 32);
+      data->depth = data_depth(entry_data);
+      data->bound = (int) ((entry_data >> 56) & 3);
+      STATS_INC(tt_hits);
+      return true;
+    }
+  }
+  return false;
+}
+
+void tt_store(transposition_table_t *table, uint64_t key, move_t move, int score, int eval, int depth, int bound) {
+  tt_cluster_t *cluster = &table->clusters[key & table->mask];
+  tt_entry_t *replace = &cluster->entries[0];
+  int replace_worth = 1 << 30;
+
+  for (int i = 0; i < TT_CLUSTER_SIZE; i++) {
+    tt_entry_t *entry = &cluster->entries[i];
+    uint64_t checksum = atomic_load_explicit(&entry->checksum, memory_order_relaxed);
+    uint64_t entry_data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+    if ((checksum ^ entry_data) == key) {
+      if (move == NO_MOVE) {
+        move = (move_t) entry_data;
+      }
+      if (bound != BOUND_EXACT && depth + 2 < data_depth(entry_data) && data_generation(entry_data) == table->generation) {
+        return;
+      }
+      replace = entry;
+      break;
+    }
+    int age = (table->generation - data_generation(entry_data)) & GENERATION_MASK;
+    int worth = data_depth(entry_data) - 8 * age;
+    if (worth < replace_worth) {
+      replace = entry;
+      replace_worth = worth;
+    }
+  }
+
+  if (depth < 0) {
+    depth = 0;
+  }
+  uint64_t data = pack_data(move, score, eval, depth, bound, table->generation);
+  atomic_store_explicit(&replace->checksum, key ^ data, memory_order_relaxed);
+  atomic_store_explicit(&replace->data, data, memory_order_relaxed);
+}
+
+int tt_hashfull(transposition_table_t *table) {
+  int used = 0;
+  int samples = (table->mask + 1 < 250) ? (int) (table->mask + 1) : 250;
+  for (int i = 0; i < samples; i++) {
+    for (int j = 0; j < TT_CLUSTER_SIZE; j++) {
+      uint64_t entry_data = atomic_load_explicit(&table->clusters[i].entries[j].data, memory_order_relaxed);
+      if (entry_data != 0 && data_generation(entry_data) == table->generation) {
+        used++;
+      }
+    }
+  }
+  return used * 1000 / (samples * TT_CLUSTER_SIZE);
+}
@@ -0,0 +1,62 @@
+#ifndef TT_H
+#define TT_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+
+#define DEFAULT_TT_SIZE_MB 16
+#define TT_CLUSTER_SIZE 4
+
+#define BOUND_NONE 0
+#define BOUND_UPPER 1
+#define BOUND_LOWER 2
+#define BOUND_EXACT 3
+
+#define TT_NO_EVAL INT16_MIN
+
+typedef struct tt_entry {
+  _Atomic uint64_t checksum;
+  _Atomic uint64_t data;
+} tt_entry_t;
+
+typedef struct tt_cluster {
+  tt_entry_t entries[TT_CLUSTER_SIZE];
+} tt_cluster_t;
+
+typedef struct tt_data {
+  move_t move;
+  int score;
+  int eval;
+  int depth;
+  int bound;
+} tt_data_t;
+
+typedef struct transposition_table {
+  tt_cluster_t *clusters;
+  uint64_t mask;
+  uint8_t generation;
+} transposition_table_t;
+
+/*
+ * The generation is only advanced by tt_new_search, so searches sharing a
+ * table must not run concurrently; the global tt serves the UCI engine.
+ */
+extern transposition_table_t tt;
+
+void tt_resize(transposition_table_t *table, size_t megabytes);
+void tt_free(transposition_table_t *table);
+void tt_clear(transposition_table_t *table);
+void tt_new_search(transposition_table_t *table);
+bool tt_probe(transposition_table_t *table, uint64_t key, tt_data_t *data);
+void tt_store(transposition_table_t *table, uint64_t key, move_t move, int score, int eval, int depth, int bound);
+int tt_hashfull(transposition_table_t *table);
+
+static inline void tt_prefetch(transposition_table_t *table, uint64_t key) {
+  __builtin_prefetch(&table->clusters[key & table->mask]);
+}
+
+#endif
@@ -0,0 +1,390 @@
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "book.h"
+#include "nnue.h"
+#include "search.h"
+#include "stats.h"
+#include "syzygy.h"
+#include "tt.h"
+#include "uci.h"
+
+#define ENGINE_NAME "chess"
+#define ENGINE_AUTHOR "rhemm23"
+#define STARTING_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+#define MAX_HASH_MB 65536
+#define MAX_THREADS 256
+#define DEFAULT_MOVES_TO_GO 30
+#define MOVE_OVERHEAD_MS 30
+#define MIN_SEARCH_TIME_MS 10
+#define MAX_OPTION_NAME_LENGTH 256
+
+typedef struct uci_state {
+  game_t game;
+  search_limits_t limits;
+  pthread_t search_thread;
+  bool searching;
+  bool infinite;
+  atomic_bool stop;
+  atomic_bool pondering;
+  pthread_mutex_t mutex;
+  pthread_cond_t released;
+  int hash_mb;
+  int threads;
+  bool best_book_move;
+} uci_state_t;
+
+static pthread_mutex_t output_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void send(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  pthread_mutex_lock(&output_mutex);
+  vprintf(format, args);
+  putchar('\n');
+  fflush(stdout);
+  pthread_mutex_unlock(&output_mutex);
+  va_end(args);
+}
+
+static void send_info(const search_info_t *info, void *arg) {
+  char line[4096];
+  char move_str[6];
+  int length;
+  unsigned long long nps = info->time_ms > 0 ? info->nodes * 1000 / info->time_ms : info->nodes;
+  (void) arg;
+
+  length = snprintf(line, sizeof(line), "info depth %d", info->depth);
+  if (info->pv_length > 0) {
+    if (info->score >= MATE_BOUND) {
+      length += snprintf(line + length, sizeof(line) - length, " score mate %d", (MATE_SCORE - info->score + 1) / 2);
+    } else if (info->score <= -MATE_BOUND) {
+      length += snprintf(line + length, sizeof(line) - length, " score mate %d", -(MATE_SCORE + info->score) / 2);
+    } else {
+      length += snprintf(line + length, sizeof(line) - length, " score cp %d", info->score);
+    }
+  }
+  length += snprintf(line + length, sizeof(line) - length, " nodes %llu nps %llu hashfull %d time %ld",
+                     info->nodes, nps, info->hashfull, info->time_ms);
+  if (info->pv_length > 0) {
+    length += snprintf(line + length, sizeof(line) - length, " pv");
+    for (int i = 0; i < info->pv_length && length < (int) sizeof(line) - 8; i++) {
+      move_to_string(info->pv[i], move_str);
+      length += snprintf(line + length, sizeof(line) - length, " %s", move_str);
+    }
+  }
+  send("%s", line);
+}
+
+static void *search_thread(void *arg) {
+  uci_state_t *state = (uci_state_t*) arg;
+  move_t book_move = (state->limits.search_moves.count == 0) ? book_probe(&state->game, state->best_book_move) : NO_MOVE;
+  search_result_t result = { book_move, NO_MOVE, 0, 0, 0 };
+  if (book_move == NO_MOVE) {
+    result = search(&state->game, &state->limits);
+  }
+  char best_str[6];
+  char ponder_str[6];
+
+  pthread_mutex_lock(&state->mutex);
+  while (!atomic_load(&state->stop) && (state->infinite || atomic_load(&state->pondering))) {
+    pthread_cond_wait(&state->released, &state->mutex);
+  }
+  pthread_mutex_unlock(&state->mutex);
+
+  move_to_string(result.best_move, best_str);
+  if (result.best_move == NO_MOVE) {
+    send("bestmove 0000");
+  } else if (result.ponder_move != NO_MOVE) {
+    move_to_string(result.ponder_move, ponder_str);
+    send("bestmove %s ponder %s", best_str, ponder_str);
+  } else {
+    send("bestmove %s", best_str);
+  }
+  return NULL;
+}
+
+static void release_search(uci_state_t *state, bool stop) {
+  pthread_mutex_lock(&state->mutex);
+  if (stop) {
+    atomic_store(&state->stop, true);
+  }
+  atomic_store(&state->pondering, false);
+  pthread_cond_broadcast(&state->released);
+  pthread_mutex_unlock(&state->mutex);
+}
+
+static void wait_for_search(uci_state_t *state) {
+  if (state->searching) {
+    pthread_join(state->search_thread, NULL);
+    state->searching = false;
+  }
+}
+
+static void stop_search(uci_state_t *state) {
+  if (state->searching) {
+    release_search(state, true);
+    wait_for_search(state);
+  }
+}
+
+static char *next_token(char **cursor) {
+  return strtok_r(NULL, " \t", cursor);
+}
+
+static void handle_position(uci_state_t *state, char **cursor) {
+  char fen[MAX_FEN_LENGTH + 32] = STARTING_FEN;
+  char *token = next_token(cursor);
+
+  if (token && strcmp(token, "fen") == 0) {
+    fen[0] = '\0';
+    while ((token = next_token(cursor)) && strcmp(token, "moves") != 0) {
+      if (strlen(fen) + strlen(token) + 2 < sizeof(fen)) {
+        strcat(fen, token);
+        strcat(fen, " ");
+      }
+    }
+  } else if (token && strcmp(token, "startpos") == 0) {
+    token = next_token(cursor);
+  }
+  if (!load_fen(&state->game, fen)) {
+    send("info string invalid fen");
+    load_fen(&state->game, STARTING_FEN);
+    return;
+  }
+  if (token && strcmp(token, "moves") == 0) {
+    while ((token = next_token(cursor))) {
+      move_t move = parse_move(&state->game, token);
+      if (move == NO_MOVE) {
+        send("info string illegal move %s", token);
+        return;
+      }
+      make_move(&state->game, move);
+    }
+  }
+}
+
+static void handle_setoption(uci_state_t *state, char **cursor) {
+  char name[MAX_OPTION_NAME_LENGTH] = "";
+  char *value = NULL;
+  char *token = next_token(cursor);
+
+  if (token == NULL || strcmp(token, "name") != 0) {
+    return;
+  }
+  while ((token = next_token(cursor)) && strcmp(token, "value") != 0) {
+    if (strlen(name) + strlen(token) + 2 < sizeof(name)) {
+      if (name[0]) {
+        strcat(name, " ");
+      }
+      strcat(name, token);
+    }
+  }
+  if (token && *cursor) {
+    value = *cursor + strspn(*cursor, " \t");
+    for (size_t length = strlen(value); length > 0 && (value[length - 1] == ' ' || value[length - 1] == '\t'); length--) {
+      value[length - 1] = '\0';
+    }
+  }
+  if (name[0] == '\0' || value == NULL || *value == '\0') {
+    return;
+  }
+  if (strcmp(name, "Hash") == 0) {
+    int hash_mb = atoi(value);
+    state->hash_mb = (hash_mb < 1) ? 1 : (hash_mb > MAX_HASH_MB) ? MAX_HASH_MB : hash_mb;
+    tt_resize(&tt, state->hash_mb);
+  } else if (strcmp(name, "EvalFile") == 0) {
+    if (nnue_load(value)) {
+      send("info string loaded network %s", value);
+    } else {
+      send("info string cannot load network %s", value);
+    }
+  } else if (strcmp(name, "BookFile") == 0) {
+    if (book_open(value)) {
+      send("info string opened book %s", value);
+    } else {
+      send("info string cannot open book %s", value);
+    }
+  } else if (strcmp(name, "BestBookMove") == 0) {
+    state->best_book_move = strcmp(value, "true") == 0;
+  } else if (strcmp(name, "SyzygyPath") == 0) {
+    send("info string found %d tablebases", syzygy_init(value));
+  } else if (strcmp(name, "Threads") == 0) {
+    int threads = atoi(value);
+    state->threads = (threads < 1) ? 1 : (threads > MAX_THREADS) ? MAX_THREADS : threads;
+  }
+}
+
+static int allocate_time(int time_left, int increment, int moves_to_go) {
+  int time_ms = time_left / moves_to_go + increment * 3 / 4;
+  if (time_ms > time_left / 2) {
+    time_ms = time_left / 2;
+  }
+  time_ms -= MOVE_OVERHEAD_MS;
+  return (time_ms < MIN_SEARCH_TIME_MS) ? MIN_SEARCH_TIME_MS : time_ms;
+}
+
+static void handle_stats(char **cursor) {
+  char *token = next_token(cursor);
+  if (token && strcmp(token, "reset") == 0) {
+    reset_search_stats();
+    return;
+  }
+  search_stats_t stats;
+  char buffer[512];
+  get_search_stats(&stats);
+  format_search_stats(&stats, buffer, sizeof(buffer));
+  send("info string %s", buffer);
+}
+
+static bool takes_value(const char *token) {
+  static const char *const keys[] = { "wtime", "btime", "winc", "binc", "movestogo", "movetime", "depth", "nodes", "mate" };
+  for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+    if (strcmp(token, keys[i]) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void handle_go(uci_state_t *state, char **cursor) {
+  search_limits_t *limits = &state->limits;
+  int time_left[2] = { 0, 0 };
+  int increment[2] = { 0, 0 };
+  int moves_to_go = DEFAULT_MOVES_TO_GO;
+  int move_time = 0;
+  bool ponder = false;
+  char *token;
+
+  memset(limits, 0, sizeof(search_limits_t));
+  state->infinite = false;
+  token = next_token(cursor);
+  while (token) {
+    char *value = NULL;
+    if (strcmp(token, "infinite") == 0) {
+      state->infinite = true;
+    } else if (strcmp(token, "ponder") == 0) {
+      ponder = true;
+    } else if (strcmp(token, "searchmoves") == 0) {
+      move_t move;
+      while ((token = next_token(cursor)) && (move = parse_move(&state->game, token)) != NO_MOVE) {
+        add_to_move_list(&limits->search_moves, move);
+      }
+      continue;
+    } else if (!takes_value(token)) {
+      /* Unknown keywords are skipped without consuming a value. */
+    } else if ((value = next_token(cursor)) == NULL) {
+      break;
+    } else if (strcmp(token, "wtime") == 0) {
+      time_left[WHITE] = atoi(value);
+    } else if (strcmp(token, "btime") == 0) {
+      time_left[BLACK] = atoi(value);
+    } else if (strcmp(token, "winc") == 0) {
+      increment[WHITE] = atoi(value);
+    } else if (strcmp(token, "binc") == 0) {
+      increment[BLACK] = atoi(value);
+    } else if (strcmp(token, "movestogo") == 0) {
+      moves_to_go = (atoi(value) > 0) ? atoi(value) : DEFAULT_MOVES_TO_GO;
+    } else if (strcmp(token, "movetime") == 0) {
+      move_time = atoi(value);
+    } else if (strcmp(token, "depth") == 0) {
+      limits->depth = atoi(value);
+    } else if (strcmp(token, "nodes") == 0) {
+      limits->nodes = strtoull(value, NULL, 10);
+    } else if (strcmp(token, "mate") == 0 && atoi(value) > 0 && limits->depth == 0) {
+      limits->depth = 2 * atoi(value) - 1;
+    }
+    token = next_token(cursor);
+  }
+
+  color_t color = state->game.color_to_move;
+  if (move_time > 0) {
+    limits->time_ms = (move_time > MOVE_OVERHEAD_MS + MIN_SEARCH_TIME_MS) ? move_time - MOVE_OVERHEAD_MS : MIN_SEARCH_TIME_MS;
+  } else if (time_left[color] > 0 && !state->infinite) {
+    limits->time_ms = allocate_time(time_left[color], increment[color], moves_to_go);
+  }
+  limits->threads = state->threads;
+  limits->stop = &state->stop;
+  limits->pondering = &state->pondering;
+  limits->info = send_info;
+
+  atomic_store(&state->stop, false);
+  atomic_store(&state->pondering, ponder);
+  state->searching = true;
+  pthread_create(&state->search_thread, NULL, search_thread, state);
+}
+
+void uci_loop(void) {
+  uci_state_t state;
+  char *line = NULL;
+  size_t capacity = 0;
+
+  init_game(&state.game);
+  load_fen(&state.game, STARTING_FEN);
+  state.searching = false;
+  state.infinite = false;
+  state.hash_mb = DEFAULT_TT_SIZE_MB;
+  state.threads = 1;
+  state.best_book_move = false;
+  atomic_init(&state.stop, false);
+  atomic_init(&state.pondering, false);
+  pthread_mutex_init(&state.mutex, NULL);
+  pthread_cond_init(&state.released, NULL);
+  tt_resize(&tt, state.hash_mb);
+
+  while (getline(&line, &capacity, stdin) != -1) {
+    char *cursor;
+    line[strcspn(line, "\r\n")] = '\0';
+    char *command = strtok_r(line, " \t", &cursor);
+    if (command == NULL) {
+      continue;
+    }
+
+    if (strcmp(command, "uci") == 0) {
+      send("id name %s", ENGINE_NAME);
+      send("id author %s", ENGINE_AUTHOR);
+      send("option name Hash type spin default %d min 1 max %d", DEFAULT_TT_SIZE_MB, MAX_HASH_MB);
+      send("option name Threads type spin default 1 min 1 max %d", MAX_THREADS);
+      send("option name Ponder type check default false");
+      send("option name EvalFile type string default <empty>");
+      send("option name SyzygyPath type string default <empty>");
+      send("option name BookFile type string default <empty>");
+      send("option name BestBookMove type check default false");
+      send("uciok");
+    } else if (strcmp(command, "isready") == 0) {
+      send("readyok");
+    } else if (strcmp(command, "stop") == 0) {
+      stop_search(&state);
+    } else if (strcmp(command, "ponderhit") == 0) {
+      release_search(&state, false);
+    } else if (strcmp(command, "quit") == 0) {
+      break;
+    } else if (strcmp(command, "ucinewgame") == 0) {
+      stop_search(&state);
+      tt_clear(&tt);
+    } else if (strcmp(command, "setoption") == 0) {
+      stop_search(&state);
+      handle_setoption(&state, &cursor);
+    } else if (strcmp(command, "position") == 0) {
+      stop_search(&state);
+      handle_position(&state, &cursor);
+    } else if (strcmp(command, "go") == 0) {
+      stop_search(&state);
+      handle_go(&state, &cursor);
+    } else if (strcmp(command, "stats") == 0) {
+      handle_stats(&cursor);
+    }
+  }
+
+  stop_search(&state);
+  book_close();
+  free(line);
+  free_game(&state.game);
+  pthread_mutex_destroy(&state.mutex);
+  pthread_cond_destroy(&state.released);
+}
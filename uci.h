@@ -0,0 +1,6 @@
+#ifndef UCI_H
+#define UCI_H
+
+void uci_loop(void);
+
+#endif
@@ -0,0 +1,44 @@
+#include <stdbool.h>
+
+#include "zobrist.h"
+
+uint64_t zobrist_pieces[2][6][64];
+uint64_t zobrist_castling[16];
+uint64_t zobrist_en_passant[8];
+uint64_t zobrist_side;
+
+static uint64_t random_u64(uint64_t *state) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 2685821657736338717ULL;
+}
+
+void init_zobrist(void) {
+  static bool initialized = false;
+  uint64_t seed = 1070372;
+  if (initialized) {
+    return;
+  }
+  for (int color = 0; color < 2; color++) {
+    for (int piece_type = 0; piece_type < 6; piece_type++) {
+      for (int square = 0; square < 64; square++) {
+        zobrist_pieces[color][piece_type][square] = random_u64(&seed);
+      }
+    }
+  }
+  zobrist_castling[0] = 0;
+  for (int castle = 0; castle < 4; castle++) {
+    uint64_t key = random_u64(&seed);
+    for (int rights = 0; rights < 16; rights++) {
+      if (rights & (1 << castle)) {
+        zobrist_castling[rights] ^= key;
+      }
+    }
+  }
+  for (int col = 0; col < 8; col++) {
+    zobrist_en_passant[col] = random_u64(&seed);
+  }
+  zobrist_side = random_u64(&seed);
+  initialized = true;
+}
@@ -0,0 +1,13 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <stdint.h>
+
+extern uint64_t zobrist_pieces[2][6][64];
+extern uint64_t zobrist_castling[16];
+extern uint64_t zobrist_en_passant[8];
+extern uint64_t zobrist_side;
+
+void init_zobrist(void);
+
+#endif